@@ -0,0 +1,66 @@
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t threadAllocationCount = 0;
+
+uint64_t GetThreadAllocationCount() {
+    return threadAllocationCount;
+}
+
+static void* Allocate(std::size_t size) {
+    threadAllocationCount++;
+    // malloc(0) may return null, but operator new must return a unique pointer
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* AllocateAligned(std::size_t size, std::align_val_t alignment) {
+    threadAllocationCount++;
+    auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    // aligned_alloc requires the size to be a multiple of the alignment
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+}
+
+static void FreeAligned(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+// The array and nothrow forms of new / delete forward to these by default, so these are all that needs replacing
+// apart from the aligned forms.
+void* operator new(std::size_t size) {
+    if (void* ptr = Allocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* ptr = AllocateAligned(size, alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    FreeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    FreeAligned(ptr);
+}
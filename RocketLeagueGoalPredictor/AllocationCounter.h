@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+
+// Number of heap allocations made through operator new on the calling thread so far. The plugin replaces the global
+// operator new to keep this count, so it only sees allocations made by the plugin's own code (ImGui allocates with
+// malloc, and other modules have their own operator new).
+// Compare the count before and after a block of code to check it doesn't allocate.
+uint64_t GetThreadAllocationCount();
@@ -0,0 +1,87 @@
+#include "FeatureBuilder.h"
+#include "RotationMath.h"
+#include <algorithm>
+#include <limits>
+#include <numbers>
+
+const double NEAR_ZERO_SECONDS_UNRELIABLE_THRESHOLD_SEC = 10;
+
+const float DEG_TO_RAD = static_cast<float>(std::numbers::pi / 180);
+
+// Scales applied per column after copying in the raw game values, as one multiply pass the compiler can vectorize.
+// We negate x-values to make them match a normal 3d space for viewers, though it doesn't actually matter for inference
+// since we augment anyway. Flipping over the x-axis means negating angvel_[yz] too, and the model expects angvel in
+// rad / sec rather than deg / sec, and boost as a percentage.
+static const std::array<float, NUM_BALL_COLS> BALL_COL_SCALES = { -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f };
+static const std::array<float, NUM_PLAYER_COLS> PLAYER_COL_SCALES = {
+    -1.0f, 1.0f, 1.0f, // pos
+    -1.0f, 1.0f, 1.0f, // vel
+    -1.0f, 1.0f, 1.0f, // rot
+    -1.0f, 1.0f, 1.0f, // up
+    DEG_TO_RAD, -DEG_TO_RAD, -DEG_TO_RAD, // angvel
+    100.0f, // boost
+    1.0f, // respawn_timer
+};
+
+inline static void CopyVec(float* out, const Vec3f& v) {
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+inline static void ApplyScales(float* data, const float* scales, int n) {
+    for (int i = 0; i < n; ++i) {
+        data[i] *= scales[i];
+    }
+}
+
+void BuildFeatures(const GameSnapshot& snapshot, const RespawnTimers& respawnTimers, FeatureVector& features) {
+    float* inputs = features.data();
+
+    CopyVec(inputs + 0, snapshot.ball.location);
+    CopyVec(inputs + 3, snapshot.ball.linearVelocity);
+    ApplyScales(inputs, BALL_COL_SCALES.data(), NUM_BALL_COLS);
+
+    // Convert all 6 cars' rotators in one batch
+    std::array<Rotator3i, 6> carRotators;
+    std::array<Vec3f, 6> carRots;
+    std::array<Vec3f, 6> carUps;
+    for (int p_index = 0; p_index < 6; ++p_index) {
+        carRotators[p_index] = snapshot.cars[p_index].rotation;
+    }
+    RotatorsToRotAndUpVectors(carRotators.data(), carRotators.size(), carRots.data(), carUps.data());
+
+    for (int p_index = 0; p_index < 6; ++p_index) {
+        const auto& car = snapshot.cars[p_index];
+        float* row = inputs + player_col_index(p_index, 0);
+
+        if (car.demolished) {
+            // Set everything but respawn_timer to nan, and hopefully infer respawn timer from our demo data,
+            // defaulting to -1 in case we didn't see the demo event :shrug:
+            std::fill(row, row + NUM_PLAYER_COLS - 1, std::numeric_limits<float>::quiet_NaN());
+            row[16] = respawnTimers.GetPlayerRespawnTimerSec(p_index, snapshot.timeMs).value_or(-1.0f);
+            continue;
+        }
+
+        CopyVec(row + 0, car.rigidBody.location);
+        CopyVec(row + 3, car.rigidBody.linearVelocity);
+        CopyVec(row + 6, carRots[p_index]);
+        CopyVec(row + 9, carUps[p_index]);
+        CopyVec(row + 12, car.rigidBody.angularVelocity);
+        row[15] = car.boostFraction;
+        row[16] = std::numeric_limits<float>::quiet_NaN(); // respawn_timer
+        ApplyScales(row, PLAYER_COL_SCALES.data(), NUM_PLAYER_COLS);
+    }
+
+    // Hopefully infer boost respawn timers from pickup events, NAN indicates boost is live
+    for (int i = 0; i < 6; i++) {
+        inputs[boost_index(i)] = respawnTimers.GetBoostRespawnTimerSec(i, snapshot.timeMs);
+    }
+}
+
+PredictionReliability GetReliability(const GameSnapshot& snapshot) {
+    // No more UNRELIABLE_MISSING_PAST_DATA checks anymore since it's uncommon, only induces minor changes, and is kinda confusing UX.
+    return snapshot.secondsRemaining > NEAR_ZERO_SECONDS_UNRELIABLE_THRESHOLD_SEC || snapshot.overtime
+        ? RELIABLE
+        : UNRELIABLE_NEAR_ZERO_SECONDS;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "GameEvents.h"
+#include "GameSnapshot.h"
+#include "RespawnTimers.h"
+#include <array>
+
+// Column layout of the model's input, matching the Kaggle competition's test set:
+// 6 ball columns, then 17 columns for each of the 6 players, then 6 big boost respawn timers.
+const int INPUT_DIM = 114;
+const int OUTPUT_DIM = 3;
+const int NUM_BALL_COLS = 6;
+const int NUM_PLAYER_COLS = 17;
+
+constexpr int player_col_index(int player_i, int player_col_i) {
+    return NUM_BALL_COLS + NUM_PLAYER_COLS * player_i + player_col_i;
+}
+
+constexpr int boost_index(int boost_i) {
+    return NUM_BALL_COLS + NUM_PLAYER_COLS * 6 + boost_i;
+}
+
+using FeatureVector = std::array<float, INPUT_DIM>;
+
+// Pure transform from a captured snapshot to the model's input columns, with no BakkesMod dependencies.
+void BuildFeatures(const GameSnapshot& snapshot, const RespawnTimers& respawnTimers, FeatureVector& features);
+
+PredictionReliability GetReliability(const GameSnapshot& snapshot);
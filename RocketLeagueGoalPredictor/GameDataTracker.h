@@ -1,17 +1,44 @@
 #pragma once
+#include "TimeSeriesPyramid.h"
 #include <map>
 #include <memory>
 #include <optional>
+#include <ranges>
+#include <type_traits>
 #include <typeindex>
+#include <variant>
+#include <vector>
 
 
 struct ITimeSeries {
     virtual ~ITimeSeries() = default;
+    virtual size_t GetNumEntries() const = 0;
+    virtual size_t GetMemoryUsageBytes() const = 0;
 };
 
 template <typename T>
 struct TimeSeries : public ITimeSeries {
     std::map<double, T> map;
+    // Only types with a Summary get a pyramid
+    std::conditional_t<Summarizable<T>, TimeSeriesPyramid<T>, std::monostate> pyramid;
+
+    size_t GetNumEntries() const override {
+        return map.size();
+    }
+
+    size_t GetMemoryUsageBytes() const override {
+        size_t bytes = sizeof(*this) + map.size() * (sizeof(typename std::map<double, T>::value_type) + MAP_NODE_OVERHEAD_BYTES);
+        if constexpr (Summarizable<T>) {
+            bytes += pyramid.GetMemoryUsageBytes();
+        }
+        return bytes;
+    }
+};
+
+struct TimeSeriesMemoryUsage {
+    std::type_index type;
+    size_t numEntries;
+    size_t bytes;
 };
 
 // What to do if overlap found when adding a new event
@@ -37,7 +64,7 @@ private:
     mutable std::map<std::type_index, std::unique_ptr<ITimeSeries>> timeSeriesMap;
 
     template <typename T>
-    std::map<double, T>& GetMap() const {
+    TimeSeries<T>& GetTimeSeries() const {
         auto typeIdx = std::type_index(typeid(T));
 
         auto [it, inserted] = timeSeriesMap.try_emplace(typeIdx, nullptr);
@@ -45,22 +72,38 @@ private:
             it->second = std::make_unique<TimeSeries<T>>();
         }
 
-        return static_cast<TimeSeries<T>*>(it->second.get())->map;
+        return *static_cast<TimeSeries<T>*>(it->second.get());
+    }
+
+    template <typename T>
+    std::map<double, T>& GetMap() const {
+        return GetTimeSeries<T>().map;
+    }
+
+    template <typename T>
+    void OnChanged(double minTimeMs, double maxTimeMs) {
+        if constexpr (Summarizable<T>) {
+            auto& timeSeries = GetTimeSeries<T>();
+            timeSeries.pyramid.Update(timeSeries.map, minTimeMs, maxTimeMs);
+        }
     }
 
 public:
+    // Returns whether data was inserted, rather than skipped for an overlapping event.
     template <typename T>
-    void AddEvent(double timeMs, const T& data, OverlapOptions options = {}) {
+    bool AddEvent(double timeMs, const T& data, OverlapOptions options = {}) {
         auto& map = GetMap<T>();
         auto range = GetRangeAroundInclusive<T>(timeMs, options.overlapRadiusMs);
+        bool erased = false;
 
         for (auto it = range.begin(); it != range.end(); /* increment handled below */) {
             if (!options.onlyLookForEqual || it->second == data) {
                 if (options.overlapAction == SKIP) {
-                    return;
+                    return false;
                 }
                 else if (options.overlapAction == REPLACE) {
                     it = map.erase(it);
+                    erased = true;
                     continue;
                 }
                 else if (options.overlapAction == REPLACE_IF_EARLIER) {
@@ -68,10 +111,14 @@ public:
                     // but currently true for our usage of this config...
                     if (timeMs < it->first) {
                         it = map.erase(it);
+                        erased = true;
                         continue;
                     }
                     else {
-                        return;
+                        if (erased) {
+                            OnChanged<T>(timeMs - options.overlapRadiusMs, timeMs + options.overlapRadiusMs);
+                        }
+                        return false;
                     }
                 }
                 // nothing for ADD
@@ -86,6 +133,8 @@ public:
         }
 
         map.emplace(timeMs, data);
+        OnChanged<T>(timeMs - options.overlapRadiusMs, timeMs + options.overlapRadiusMs);
+        return true;
     }
 
     template <typename T>
@@ -100,6 +149,21 @@ public:
         return std::ranges::subrange(map.lower_bound(minTimeMs), map.upper_bound(maxTimeMs));
     }
 
+    // Visits events of T in [minTimeMs, maxTimeMs] in order. fn returns the earliest time it wants to see next, and
+    // anything before that is skipped with a single lookup rather than visited, so the cost depends on how much fn
+    // keeps rather than how many events are in range.
+    template <typename T, typename F>
+    void ForEachSkipping(double minTimeMs, double maxTimeMs, F&& fn) const {
+        auto& map = GetMap<T>();
+        auto end = map.upper_bound(maxTimeMs);
+        for (auto it = map.lower_bound(minTimeMs); it != end;) {
+            double nextTimeMs = fn(it->first, it->second);
+            if (++it != end && it->first < nextTimeMs) {
+                it = nextTimeMs > maxTimeMs ? end : map.lower_bound(nextTimeMs);
+            }
+        }
+    }
+
     template <typename T>
     std::ranges::subrange<typename std::map<double, T>::iterator> GetRangeAroundInclusive(double timeMs, double radiusMs) const {
         return GetRangeInclusive<T>(timeMs - radiusMs, timeMs + radiusMs);
@@ -161,6 +225,30 @@ public:
             : std::make_pair(it_next->first, it_next->second);
     }
 
+    // Visits multi-resolution summaries of T over [minTimeMs, maxTimeMs], see TimeSeriesPyramid::ForEachSummary().
+    template <typename T, typename F> requires Summarizable<T>
+    void ForEachSummary(double minTimeMs, double maxTimeMs, double minBucketWidthMs, F&& fn) const {
+        GetTimeSeries<T>().pyramid.ForEachSummary(minTimeMs, maxTimeMs, minBucketWidthMs, std::forward<F>(fn));
+    }
+
+    // Approximate heap usage of all the series, including their pyramids.
+    size_t GetMemoryUsageBytes() const {
+        size_t bytes = 0;
+        for (const auto& [typeIdx, timeSeries] : timeSeriesMap) {
+            bytes += timeSeries->GetMemoryUsageBytes() + sizeof(typeIdx) + MAP_NODE_OVERHEAD_BYTES;
+        }
+        return bytes;
+    }
+
+    // Breakdown of GetMemoryUsageBytes() by series.
+    std::vector<TimeSeriesMemoryUsage> GetTimeSeriesMemoryUsage() const {
+        std::vector<TimeSeriesMemoryUsage> usage;
+        for (const auto& [typeIdx, timeSeries] : timeSeriesMap) {
+            usage.push_back({ typeIdx, timeSeries->GetNumEntries(), timeSeries->GetMemoryUsageBytes() });
+        }
+        return usage;
+    }
+
     void Clear() {
         timeSeriesMap.clear();
     }
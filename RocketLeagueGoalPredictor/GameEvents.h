@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <string>
 
 enum GameType {
@@ -33,9 +34,13 @@ struct BallHitEvent {
     auto operator<=>(const BallHitEvent&) const = default;
 };
 
+// Interned handle for a player's unique id, see PlayerRegistry
+using PlayerId = int;
+
 struct DemolitionEvent {
     bool victim_orange; // else blue
-    std::string victim_pri_id;
+    PlayerId victim_id;
+    int victim_index; // player slot in the model inputs, 0-2 blue and 3-5 orange
 
     auto operator<=>(const DemolitionEvent&) const = default;
 };
@@ -97,4 +102,41 @@ struct Prediction {
     }
 
     auto operator<=>(const Prediction&) const = default;
+
+    // Aggregate over a run of predictions, for drawing long histories (see TimeSeriesPyramid).
+    struct Summary {
+        float min_blue, max_blue, sum_blue;
+        float min_orange, max_orange, sum_orange;
+        float min_delta, max_delta, sum_delta;
+        int count;
+        int unreliable_count;
+
+        static Summary Of(const Prediction& p) {
+            return {
+                p.prob_blue, p.prob_blue, p.prob_blue,
+                p.prob_orange, p.prob_orange, p.prob_orange,
+                p.prob_delta, p.prob_delta, p.prob_delta,
+                1, p.reliability == RELIABLE ? 0 : 1,
+            };
+        }
+
+        void Merge(const Summary& other) {
+            min_blue = std::min(min_blue, other.min_blue);
+            max_blue = std::max(max_blue, other.max_blue);
+            sum_blue += other.sum_blue;
+            min_orange = std::min(min_orange, other.min_orange);
+            max_orange = std::max(max_orange, other.max_orange);
+            sum_orange += other.sum_orange;
+            min_delta = std::min(min_delta, other.min_delta);
+            max_delta = std::max(max_delta, other.max_delta);
+            sum_delta += other.sum_delta;
+            count += other.count;
+            unreliable_count += other.unreliable_count;
+        }
+
+        float MeanBlue() const { return sum_blue / count; }
+        float MeanOrange() const { return sum_orange / count; }
+        float MeanDelta() const { return sum_delta / count; }
+        bool MostlyReliable() const { return unreliable_count * 2 <= count; }
+    };
 };
\ No newline at end of file
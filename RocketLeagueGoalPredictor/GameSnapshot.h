@@ -0,0 +1,40 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Plain copies of the game state the model needs, captured on the game thread (see SnapshotCapture.h) so that
+// feature building doesn't need to touch any BakkesMod wrappers. Everything is in raw game coordinates and units.
+
+struct Vec3f {
+    float x;
+    float y;
+    float z;
+};
+
+// Unreal rotator, where 65536 units is a full turn
+struct Rotator3i {
+    int32_t pitch;
+    int32_t yaw;
+    int32_t roll;
+};
+
+struct RigidBodySnapshot {
+    Vec3f location;
+    Vec3f linearVelocity;
+    Vec3f angularVelocity; // degrees / sec
+};
+
+struct CarSnapshot {
+    bool demolished; // If so, only the respawn timer is known
+    RigidBodySnapshot rigidBody;
+    Rotator3i rotation;
+    float boostFraction; // 0-1
+};
+
+struct GameSnapshot {
+    double timeMs; // Game Time domain, same as GameDataTracker
+    RigidBodySnapshot ball;
+    std::array<CarSnapshot, 6> cars; // Indexed by player slot, 0-2 blue and 3-5 orange
+    int secondsRemaining;
+    bool overtime;
+};
@@ -1,9 +1,13 @@
 #pragma comment(lib, "pluginsdk.lib")
 #include "pch.h"
 #include "GoalPredictor.h"
+#include "SnapshotCapture.h"
+#include "Tracer.h"
 #include "utils.h"
 #include "version.h"
-#include <future>
+#include <algorithm>
+#include <cctype>
+#include <typeindex>
 
 BAKKESMOD_PLUGIN(GoalPredictor, "Goal Predictor", stringify(VERSION_MAJOR) "." stringify(VERSION_MINOR) "." stringify(VERSION_PATCH), PLUGINTYPE_SPECTATOR | PLUGINTYPE_REPLAY)
 
@@ -11,14 +15,69 @@ std::shared_ptr<CVarManagerWrapper> _globalCvarManager;
 
 const std::string MODEL_FILE_NAME = "goal_predictor_model_3v3.onnx";
 
-const double PREDICTION_OVERLAP_RADIUS_MS = 30; // Cap prediction frame rate (in game time) to just over 30 FPS (replays are limited to 30 FPS anyway).
 const OverlapOptions BALL_HIT_EVENT_OVERLAP_OPTIONS = { .overlapRadiusMs = 250, .onlyLookForEqual = true };
 
 const double LOG_FREQUENCY_MS = 1000;
 
+const std::chrono::milliseconds UNLOAD_PREDICTION_TIMEOUT(2000);
+
+// GetGameKey() walks the PRIs and goals, so only recompute it after one of these hooks says the game may have changed.
+// Also recheck on an interval as a safety net in case we miss some transition.
+const std::string GAME_KEY_INVALIDATION_EVENTS[] = {
+	"Function TAGame.GameEvent_Soccar_TA.PostBeginPlay", // Match start
+	"Function TAGame.GameEvent_Soccar_TA.EventMatchEnded",
+	"Function TAGame.GameEvent_Soccar_TA.Destroyed",
+	"Function TAGame.PRI_TA.PostBeginPlay", // PRI join
+	"Function TAGame.PRI_TA.Destroyed", // PRI leave
+	"Function TAGame.PRI_TA.OnTeamChanged", // Includes switching to / from spectator
+	"Function TAGame.GameInfo_Replay_TA.HandleReplayImported", // Replay load
+	"Function TAGame.Replay_TA.EventPostTimeSkip", // Seeking around a replay can recreate the PRIs
+	"Function Engine.PlayerController.Spectating.BeginState",
+	"Function Engine.PlayerController.Spectating.EndState",
+};
+const double GAME_KEY_RECHECK_INTERVAL_MS = 1000;
+const std::string SNAPSHOT_FOLDER_NAME = "goal_predictor_snapshots";
+// Bounds the time spent writing queued log records to the console each frame
+const size_t MAX_LOG_RECORDS_PER_TICK = 32;
+// How often peak memory usage is sampled for GoalPredictor_DumpMemory
+const double MEMORY_SAMPLE_INTERVAL_MS = 1000;
+
+// "Function TAGame.Car_TA.EventHitBall" -> "Car_TA.EventHitBall"
+static std::string GetHookDisplayName(const std::string& eventName) {
+	auto lastDot = eventName.rfind('.');
+	auto start = lastDot == std::string::npos || lastDot == 0 ? std::string::npos : eventName.rfind('.', lastDot - 1);
+	if (start == std::string::npos) {
+		start = eventName.rfind(' ');
+	}
+	return start == std::string::npos ? eventName : eventName.substr(start + 1);
+}
+
+template <typename F>
+void GoalPredictor::HookEventTimed(const std::string& eventName, F&& callback) {
+	HookCost& cost = hookCosts.Add(GetHookDisplayName(eventName));
+	gameWrapper->HookEvent(eventName, [&cost, callback = std::forward<F>(callback)](std::string eventName) {
+		ScopedHookTimer timer(cost);
+		ScopedTrace trace(cost.name.c_str());
+		callback(std::move(eventName));
+	});
+}
+
+template <typename T, typename F>
+void GoalPredictor::HookEventWithCallerTimed(const std::string& eventName, F&& callback) {
+	HookCost& cost = hookCosts.Add(GetHookDisplayName(eventName));
+	gameWrapper->HookEventWithCaller<T>(eventName, [&cost, callback = std::forward<F>(callback)](T caller, void* params, std::string eventName) {
+		ScopedHookTimer timer(cost);
+		ScopedTrace trace(cost.name.c_str());
+		callback(caller, params, std::move(eventName));
+	});
+}
+
 template <typename T>
-inline void GoalPredictor::AddEvent(const T& event, OverlapOptions options) {
-	gameDataTracker.AddEvent(GetCurrentGameTimeMs(gameWrapper), event, options);
+inline bool GoalPredictor::AddEvent(const T& event, OverlapOptions options) {
+	auto currentGameTimeMs = GetCurrentGameTimeMs(gameWrapper);
+	bool added = gameDataTracker.AddEvent(currentGameTimeMs, event, options);
+	snapshotRecorder.RecordEvent(currentGameTimeMs, event);
+	return added;
 }
 
 inline bool GoalPredictor::IsActive(bool assertGameLive) {
@@ -46,13 +105,21 @@ void GoalPredictor::onLoad() {
 	LoadRenderer();
 
 	ResetLocalState();
+	FlushLog(SIZE_MAX);
 }
 
 void GoalPredictor::onUnload() {
-	// This waits for any pending futures to complete.
+	// Cancel pending predictions, then wait (bounded) for them to finish since they still reference the engine.
+	// Stopping the pool then discards any jobs still queued, so it only waits for runs that were already terminated.
 	ResetLocalState();
+	if (!pendingPredictions.WaitAll(UNLOAD_PREDICTION_TIMEOUT)) {
+		LOG("Timed out waiting for pending predictions to finish.");
+	}
+	inferencePool.Stop();
 
 	inferenceEngine.Deinitialize();
+	snapshotRecorder.Stop();
+	FlushLog(SIZE_MAX);
 }
 
 void GoalPredictor::LoadCVars() {
@@ -71,6 +138,13 @@ void GoalPredictor::LoadCVars() {
 		*showTitleBar = newCvar.getBoolValue();
 	});
 
+	showDiagnosticsCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_ShowDiagnostics", "0", "Show Performance Diagnostics", true, true, 0, true, 1));
+	showDiagnostics = std::make_shared<bool>(showDiagnosticsCvar->getBoolValue());
+	showDiagnosticsCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*showDiagnostics = newCvar.getBoolValue();
+	});
+
 	opacityPctCvar = std::make_shared<CVarWrapper>(
 		cvarManager->registerCvar("GoalPredictor_Opacity", std::to_string(DEFAULT_OPACITY), "Background Opacity %", true, true, (float)MIN_OPACITY, true, (float)MAX_OPACITY));
 	opacityPct = std::make_shared<int>(opacityPctCvar->getIntValue());
@@ -105,6 +179,137 @@ void GoalPredictor::LoadCVars() {
 	logInputsCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
 		*logInputs = newCvar.getBoolValue();
 	});
+
+	logRenderAllocationsCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_LogRenderAllocations", "0", "Log Overlay Heap Allocations", true, true, 0, true, 1));
+	logRenderAllocations = std::make_shared<bool>(logRenderAllocationsCvar->getBoolValue());
+	logRenderAllocationsCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*logRenderAllocations = newCvar.getBoolValue();
+	});
+
+	inferenceThreadsCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_InferenceThreads", std::to_string(DEFAULT_INFERENCE_THREADS), "Number of concurrent model inferences", true, true, (float)MIN_INFERENCE_THREADS, true, (float)MAX_INFERENCE_THREADS));
+	inferenceThreads = std::make_shared<int>(inferenceThreadsCvar->getIntValue());
+	inferenceThreadsCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*inferenceThreads = newCvar.getIntValue();
+		RestartInferencePool();
+	});
+
+	inferenceCoresCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_InferenceCores", "0", "Pin inference threads to this many of the last physical CPU cores (0 = any core)", true, true, 0, true, 64));
+	inferenceCores = std::make_shared<int>(inferenceCoresCvar->getIntValue());
+	inferenceCoresCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*inferenceCores = newCvar.getIntValue();
+		RestartInferencePool();
+	});
+
+	inferenceLowPriorityCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_InferenceLowPriority", "1", "Run inference threads below normal priority", true, true, 0, true, 1));
+	inferenceLowPriority = std::make_shared<bool>(inferenceLowPriorityCvar->getBoolValue());
+	inferenceLowPriorityCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*inferenceLowPriority = newCvar.getBoolValue();
+		RestartInferencePool();
+	});
+
+	RestartInferencePool();
+
+	targetFpsCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_TargetFps", std::to_string(DEFAULT_TARGET_FPS), "Throttle predictions when the game runs below this FPS. Set it no higher than your frame rate cap, or predictions stay throttled", true, true, MIN_TARGET_FPS, true, MAX_TARGET_FPS));
+	targetFps = std::make_shared<int>(targetFpsCvar->getIntValue());
+	predictionRateController.SetTargetFps(*targetFps);
+	targetFpsCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*targetFps = newCvar.getIntValue();
+		predictionRateController.SetTargetFps(*targetFps);
+	});
+	cvarManager->registerNotifier("GoalPredictor_DumpLatency", [this](std::vector<std::string> args) {
+		DumpLatencyHistograms();
+	}, "Log latency percentiles for each prediction pipeline stage", PERMISSION_ALL);
+
+	cvarManager->registerNotifier("GoalPredictor_ResetLatency", [this](std::vector<std::string> args) {
+		for (auto& histogram : GetPipelineHistograms()) {
+			histogram.Reset();
+		}
+		LOG("Latency histograms reset.");
+	}, "Reset the latency histograms used by GoalPredictor_DumpLatency", PERMISSION_ALL);
+
+	profileRunsCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_ProfileRuns", "0", "Profile the model over this many predictions and log the slowest nodes", true, true, 0, true, (float)MAX_PROFILE_RUNS));
+	profileRuns = std::make_shared<int>(0);
+	profileRunsCvar->setValue(0); // Profiling is a one off, so don't restart it from a saved config
+	profileRunsCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*profileRuns = newCvar.getIntValue();
+		if (*profileRuns <= 0) {
+			return;
+		}
+		auto outputPrefix = gameWrapper->GetDataFolder() / "goal_predictor_profile";
+		if (inferenceEngine.StartProfiling(*profileRuns, outputPrefix)) {
+			LOG("Profiling the model over the next {} predictions...", *profileRuns);
+		}
+		else {
+			LOG("Couldn't start model profiling, either no model is loaded or a profile is already in progress.");
+		}
+	});
+
+	cvarManager->registerNotifier("GoalPredictor_DumpHookCosts", [this](std::vector<std::string> args) {
+		DumpHookCosts();
+	}, "Log the call count and game thread time spent in each event hook", PERMISSION_ALL);
+
+	cvarManager->registerNotifier("GoalPredictor_ResetHookCosts", [this](std::vector<std::string> args) {
+		hookCosts.Reset();
+		LOG("Reset hook costs.");
+	}, "Reset the counters used by GoalPredictor_DumpHookCosts", PERMISSION_ALL);
+
+	cvarManager->registerNotifier("GoalPredictor_DumpMemory", [this](std::vector<std::string> args) {
+		DumpMemoryUsage();
+	}, "Log the memory used by the model, tracked game data, pending predictions and fonts", PERMISSION_ALL);
+
+	recordSnapshotsCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_RecordSnapshots", "0", "Record model inputs, events and predictions to a file per game", true, true, 0, true, 1));
+	recordSnapshots = std::make_shared<bool>(recordSnapshotsCvar->getBoolValue());
+	if (*recordSnapshots) {
+		snapshotRecorder.Start();
+	}
+	recordSnapshotsCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*recordSnapshots = newCvar.getBoolValue();
+		if (*recordSnapshots) {
+			snapshotRecorder.Start();
+			UpdateSnapshotFile();
+		}
+		else {
+			snapshotRecorder.CloseFile();
+			LOG("Stopped recording snapshots, {:.1f} MB written and {} records dropped so far.",
+				snapshotRecorder.GetNumBytesWritten() / 1048576.0, snapshotRecorder.GetNumDropped());
+		}
+	});
+
+	tracingCvar = std::make_shared<CVarWrapper>(
+		cvarManager->registerCvar("GoalPredictor_Tracing", "0", "Record trace events for GoalPredictor_DumpTrace", true, true, 0, true, 1));
+	tracing = std::make_shared<bool>(tracingCvar->getBoolValue());
+	SetTracingEnabled(*tracing);
+	tracingCvar->addOnValueChanged([this](std::string cvarName, CVarWrapper newCvar) {
+		*tracing = newCvar.getBoolValue();
+		SetTracingEnabled(*tracing);
+	});
+
+	cvarManager->registerNotifier("GoalPredictor_DumpTrace", [this](std::vector<std::string> args) {
+		auto path = gameWrapper->GetDataFolder() / ("goal_predictor_trace_" + std::to_string((int64_t)GetCurrentEpochTimeMs()) + ".json");
+		int numEvents = WriteTraceJson(path);
+		if (numEvents < 0) {
+			LOG("Failed to write trace to {}", path.string());
+			return;
+		}
+		LOG("Wrote {} trace events to {}", numEvents, path.string());
+		if (numEvents == 0 && !*tracing) {
+			LOG("Set GoalPredictor_Tracing 1 to record trace events.");
+		}
+	}, "Write recent trace events to a chrome://tracing / Perfetto JSON file in the BakkesMod data folder", PERMISSION_ALL);
+}
+
+// Lanes only apply their thread settings when they start, so any change to them needs a restart.
+void GoalPredictor::RestartInferencePool() {
+	// Restarting discards queued jobs, whose predictions would otherwise stay pending forever
+	CancelPendingPredictions();
+	inferencePool.Start(*inferenceThreads, { .numLastCores = *inferenceCores, .lowPriority = *inferenceLowPriority });
 }
 
 void GoalPredictor::LoadModel() {
@@ -120,7 +325,7 @@ void GoalPredictor::LoadModel() {
 }
 
 void GoalPredictor::LoadEventHooks() {
-	gameWrapper->HookEventWithCaller<ServerWrapper>("Function TAGame.GameEvent_Soccar_TA.OnGameTimeUpdated", [this](ServerWrapper server, void* params, std::string eventName) {
+	HookEventWithCallerTimed<ServerWrapper>("Function TAGame.GameEvent_Soccar_TA.OnGameTimeUpdated", [this](ServerWrapper server, void* params, std::string eventName) {
 		if (!IsActive(true)) {
 			return;
 		}
@@ -129,7 +334,7 @@ void GoalPredictor::LoadEventHooks() {
 		AddEvent(SecondEvent(server.GetSecondsRemaining(), static_cast<bool>(server.GetbOverTime())), { .overlapRadiusMs = 1200, .onlyLookForEqual = true, .overlapAction = REPLACE_IF_EARLIER });
 	});
 
-	gameWrapper->HookEventWithCaller<CarWrapper>("Function TAGame.Car_TA.EventHitBall", [this](CarWrapper car, void* params, std::string eventName) {
+	HookEventWithCallerTimed<CarWrapper>("Function TAGame.Car_TA.EventHitBall", [this](CarWrapper car, void* params, std::string eventName) {
 		if (!IsActive(true) || !car || car.IsNull()) {
 			return;
 		}
@@ -139,7 +344,7 @@ void GoalPredictor::LoadEventHooks() {
 
 	// Sometimes this fires when the above doesn't for some reason, so we need it. And this won't fire if a teammate touches next, so we need the above.
 	// And often enough *neither* fires on a clear ball touch for some reason, and I couldn't find anything usable in the Function Scanner for those cases...
-	gameWrapper->HookEventWithCaller<ActorWrapper>("Function TAGame.Ball_TA.OnHitTeamNumChanged", [this](ActorWrapper ball, void* params, std::string eventName) {
+	HookEventWithCallerTimed<ActorWrapper>("Function TAGame.Ball_TA.OnHitTeamNumChanged", [this](ActorWrapper ball, void* params, std::string eventName) {
 		if (!IsActive(true)) {
 			return;
 		}
@@ -147,24 +352,29 @@ void GoalPredictor::LoadEventHooks() {
 		AddEvent(BallHitEvent(gameWrapper->GetCurrentGameState().GetBall().GetHitTeamNum() == 1), BALL_HIT_EVENT_OVERLAP_OPTIONS);
 	});
 
-	gameWrapper->HookEventWithCaller<ActorWrapper>("Function VehiclePickup_Boost_TA.Idle.EndState", [this](ActorWrapper actor, void* params, std::string eventName) {
+	HookEventWithCallerTimed<ActorWrapper>("Function VehiclePickup_Boost_TA.Idle.EndState", [this](ActorWrapper actor, void* params, std::string eventName) {
 		if (!IsActive(true)) {
 			return;
 		}
 
-		auto bigBoostIndex = InferenceEngine::GetBigBoostIndex(actor.GetLocation());
+		auto bigBoostIndex = GetBigBoostIndex(actor.GetLocation());
 		if (bigBoostIndex.has_value()) {
-			AddEvent(BigBoostPickupEvent(bigBoostIndex.value()), { .overlapRadiusMs = 200, .onlyLookForEqual = true });
+			// Only when the tracker kept it, so the timers never run ahead of what a rebuild from the tracker would give
+			if (AddEvent(BigBoostPickupEvent(bigBoostIndex.value()), { .overlapRadiusMs = 200, .onlyLookForEqual = true })) {
+				respawnTimers.OnBigBoostPickup(GetCurrentGameTimeMs(gameWrapper), bigBoostIndex.value());
+			}
 		}
 	});
 
-	gameWrapper->HookEventWithCaller<CarWrapper>("Function TAGame.Car_TA.EventDemolished", [this](CarWrapper victim, void* params, std::string eventName) {
+	HookEventWithCallerTimed<CarWrapper>("Function TAGame.Car_TA.EventDemolished", [this](CarWrapper victim, void* params, std::string eventName) {
 		if (!IsActive(true) || !victim || victim.IsNull()) {
 			return;
 		}
 
 		// It seems the victim.GetPRI() link has already been detached by now, but luckily we can search for the backref pri.GetCar() which still points to the victim.
-		auto pris = gameWrapper->GetCurrentGameState().GetPRIs();
+		auto server = gameWrapper->GetCurrentGameState();
+		playerRegistry.Refresh(server);
+		auto pris = server.GetPRIs();
 		for (int i = 0; i < pris.Count(); i++) {
 			PriWrapper pri = pris.Get(i);
 			if (!pri || pri.IsNull() || pri.GetTeamNum() > 1) {
@@ -173,30 +383,37 @@ void GoalPredictor::LoadEventHooks() {
 
 			auto car = pri.GetCar();
 			if (car && car.memory_address == victim.memory_address) {
-				AddEvent(DemolitionEvent(pri.GetTeamNum() == 1, GetId(pri)), { .overlapRadiusMs = 200, .onlyLookForEqual = true });
+				auto p_index = playerRegistry.GetSlot(pri.memory_address);
+				if (p_index.has_value()) {
+					auto playerId = playerRegistry.GetPlayerId(p_index.value()).value();
+					if (AddEvent(DemolitionEvent(pri.GetTeamNum() == 1, playerId, p_index.value()), { .overlapRadiusMs = 200, .onlyLookForEqual = true })) {
+						respawnTimers.OnDemolition(GetCurrentGameTimeMs(gameWrapper), p_index.value());
+					}
+				}
 
 				return;
 			}
 		}
 	});
 
-	gameWrapper->HookEvent("Function GameEvent_Soccar_TA.Countdown.BeginState", [this](std::string eventName) {
+	HookEventTimed("Function GameEvent_Soccar_TA.Countdown.BeginState", [this](std::string eventName) {
 		if (!IsActive(false)) {
 			return;
 		}
 
 		AddEvent(KickoffEvent(), { .overlapRadiusMs = 1000 });
+		respawnTimers.OnKickoff();
 	});
 
-	gameWrapper->HookEvent("Function GameEvent_Soccar_TA.ReplayPlayback.BeginState", [this](std::string eventName) {
+	HookEventTimed("Function GameEvent_Soccar_TA.ReplayPlayback.BeginState", [this](std::string eventName) {
 		inGoalReplay = true;
 	});
 
-	gameWrapper->HookEvent("Function GameEvent_Soccar_TA.ReplayPlayback.EndState", [this](std::string eventName) {
+	HookEventTimed("Function GameEvent_Soccar_TA.ReplayPlayback.EndState", [this](std::string eventName) {
 		inGoalReplay = false;
 	});
 
-	gameWrapper->HookEventWithCaller<ServerWrapper>("Function TAGame.GameEvent_Soccar_TA.TriggerGoalScoreEvent", [this](ServerWrapper caller, void* paramsPtr, std::string eventName) {
+	HookEventWithCallerTimed<ServerWrapper>("Function TAGame.GameEvent_Soccar_TA.TriggerGoalScoreEvent", [this](ServerWrapper caller, void* paramsPtr, std::string eventName) {
 		if (!IsActive(false) || inGoalReplay) {
 			return;
 		}
@@ -209,31 +426,72 @@ void GoalPredictor::LoadEventHooks() {
 
 		if (p->TeamScoredOn == 0 || p->TeamScoredOn == 1) {
 			AddEvent(GoalEvent(p->TeamScoredOn == 0), { .overlapRadiusMs = 200 });
+			respawnTimers.OnKickoff();
 		}
 	});
 
-	gameWrapper->HookEvent("Function Engine.GameViewportClient.Tick", [this](std::string eventName) {
-		GameKey gameKey = GetGameKey(gameWrapper);
-		if (gameKey != currentGameKey) {
-			ResetLocalState(gameKey);
+	for (const auto& eventName : GAME_KEY_INVALIDATION_EVENTS) {
+		HookEventTimed(eventName, [this](std::string eventName) {
+			nextGameKeyCheckEpochTimeMs = 0;
+		});
+	}
+
+	HookEventTimed("Function Engine.GameViewportClient.Tick", [this](std::string eventName) {
+		SetTraceThreadName("Game");
+		FlushLog(MAX_LOG_RECORDS_PER_TICK);
+		double currentEpochTimeMs = GetCurrentEpochTimeMs();
+		// This hook fires once per rendered frame, so the real time between calls is the game's frame time.
+		if (lastTickEpochTimeMs >= 0) {
+			predictionRateController.OnFrame(currentEpochTimeMs - lastTickEpochTimeMs);
 		}
-		if (!gameKey.IsActive()) {
+		lastTickEpochTimeMs = currentEpochTimeMs;
+
+		// Put the cvar back once the requested runs have been profiled, so setting it again starts a new profile
+		if (*profileRuns > 0 && !inferenceEngine.IsProfiling()) {
+			profileRunsCvar->setValue(0);
+		}
+
+		if (currentEpochTimeMs >= nextGameKeyCheckEpochTimeMs) {
+			nextGameKeyCheckEpochTimeMs = currentEpochTimeMs + GAME_KEY_RECHECK_INTERVAL_MS;
+
+			GameKey gameKey = GetGameKey(gameWrapper);
+			if (gameKey != currentGameKey) {
+				ResetLocalState(gameKey);
+			}
+		}
+		if (!currentGameKey.IsActive()) {
 			return;
 		}
 
 		// Handle any prediction tasks that have completed.
-		auto completedPredictions = pendingPredictions.GetCompletedTasks();
-		for (const auto& [timeMs, prediction] : completedPredictions) {
-			if (prediction.has_value()) {
-				gameDataTracker.AddEvent<Prediction>(
-					timeMs,
-					prediction.value(),
-					{ .overlapRadiusMs = PREDICTION_OVERLAP_RADIUS_MS, .overlapAction = REPLACE }
-				);
+		{
+			ScopedTrace completedTrace("HandleCompletedPredictions");
+			auto completedPredictions = pendingPredictions.GetCompletedTasks();
+			for (const auto& [timeMs, prediction] : completedPredictions) {
+				performanceStats.OnPredictionCompleted(prediction, currentEpochTimeMs);
+				if (prediction.has_value()) {
+					snapshotRecorder.RecordPrediction(timeMs, prediction.value());
+					ScopedStageTimer timer(STAGE_RESULT_INSERT);
+					gameDataTracker.AddEvent<Prediction>(
+						timeMs,
+						prediction.value(),
+						// The finest interval rather than the current one, which can be 200ms or more while throttled or
+						// fast-forwarding and would wipe out neighbouring predictions already made at a finer rate
+						{ .overlapRadiusMs = MIN_PREDICTION_INTERVAL_MS, .overlapAction = REPLACE }
+					);
+				}
+			}
+			if (!completedPredictions.empty()) {
+				LogPredictionTime();
 			}
 		}
-		if (!completedPredictions.empty()) {
-			LogPredictionTime();
+		performanceStats.SetQueueDepth(static_cast<int>(pendingPredictions.GetNumPending()));
+		if (*showDiagnostics) {
+			performanceStats.SetTrackerMemoryBytes(gameDataTracker.GetMemoryUsageBytes());
+		}
+		if (currentEpochTimeMs >= nextMemorySampleEpochTimeMs) {
+			nextMemorySampleEpochTimeMs = currentEpochTimeMs + MEMORY_SAMPLE_INTERVAL_MS;
+			SampleMemoryPeaks();
 		}
 
 		// Update time tracking
@@ -243,6 +501,11 @@ void GoalPredictor::LoadEventHooks() {
 		auto newWorldTime = currentWorldTimeMs != lastTickWorldTimeMs;
 
 		if (currentGameTimeMs != lastGameTimeMs) {
+			// World time follows the replay playback speed, so measure game time against real time instead
+			if (lastGameTimeMs >= 0) {
+				predictionRateController.OnGameTimeAdvanced(currentGameTimeMs - lastGameTimeMs, currentEpochTimeMs - lastGameTimeEpochTimeMs);
+			}
+			lastGameTimeEpochTimeMs = currentEpochTimeMs;
 			lastGameTimeWorldTimeMs = currentWorldTimeMs;
 			lastTickWorldTimeMs = currentWorldTimeMs;
 		}
@@ -258,42 +521,109 @@ void GoalPredictor::LoadEventHooks() {
 
 		// Make a prediction, as long as there's no existing nearby predictions.
 		// In practice there should only be 0 or 1 existing Predictions in this range, but let's be defensive
-		auto overlapRange = gameDataTracker.GetRangeAroundInclusive<Prediction>(currentGameTimeMs, PREDICTION_OVERLAP_RADIUS_MS);
+		// The spacing between predictions adapts to how well the game is keeping up with its target frame rate,
+		// and to the replay playback speed.
+		auto predictionIntervalMs = predictionRateController.GetGameIntervalMs();
+		auto overlapRange = gameDataTracker.GetRangeAroundInclusive<Prediction>(currentGameTimeMs, predictionIntervalMs);
 		// Check overlap in pending predictions too
 		auto closestPendingMs = pendingPredictions.GetClosestTimeMs(currentGameTimeMs);
 		bool alreadyScheduled = closestPendingMs.has_value() &&
-			std::abs(closestPendingMs.value() - currentGameTimeMs) <= PREDICTION_OVERLAP_RADIUS_MS;
+			std::abs(closestPendingMs.value() - currentGameTimeMs) <= predictionIntervalMs;
 		if (!overlapRange.empty() || alreadyScheduled) {
 			return;
 		}
 
-		// Prepare the inputs to the model using the game objects which the prediction thread can't read from safely.
-		auto input = inferenceEngine.GetInferenceInput(gameWrapper->GetCurrentGameState(), gameDataTracker, currentGameTimeMs, ShouldLogInputs());
-		if (!input) {
+		if (!inferenceEngine.IsInitialized()) {
 			return;
 		}
 
-		// Start the async prediction task and store it in our watcher set.
-		pendingPredictions.Add(currentGameTimeMs, std::async(
-			std::launch::async,
-			[this, input = std::move(input.value())]() {
-				return inferenceEngine.Predict(input, *augmentation);
+		// If every inference lane is already backed up, a new prediction would only be stale by the time it ran.
+		if (inferencePool.IsSaturated()) {
+			performanceStats.OnPredictionSkipped();
+			return;
+		}
+
+		// Capture the game objects which the prediction thread can't read from safely, then build the model inputs from that copy.
+		auto server = gameWrapper->GetCurrentGameState();
+		InferenceInput input;
+		{
+			ScopedStageTimer timer(STAGE_CAPTURE);
+			ScopedTrace trace("Capture");
+			playerRegistry.Refresh(server);
+			auto snapshot = CaptureSnapshot(server, playerRegistry, currentGameTimeMs);
+			if (!snapshot) {
+				return;
 			}
-		));
+
+			respawnTimers.Sync(gameDataTracker, currentGameTimeMs);
+			BuildFeatures(snapshot.value(), respawnTimers, input.inputs);
+			input.reliability = GetReliability(snapshot.value());
+		}
+		snapshotRecorder.RecordInput(currentGameTimeMs, input);
+		if (ShouldLogInputs()) {
+			LogFeatures(server, playerRegistry, input.inputs, currentGameTimeMs);
+		}
+
+		// Queue the prediction on the next free inference lane and store it in our watcher set.
+		pendingPredictions.Add(currentGameTimeMs,
+			[this, input, currentAugmentation = predictionRateController.GetAugmentation(*augmentation), generation = pendingPredictions.GetGeneration(),
+				queuedTime = std::chrono::steady_clock::now()](InferenceLane& lane) {
+				GetPipelineHistograms()[STAGE_QUEUE_WAIT].Record(std::chrono::steady_clock::now() - queuedTime);
+				return inferenceEngine.Predict(input, currentAugmentation, generation, lane.buffers);
+			},
+			[this](auto job) {
+				inferencePool.Submit(std::move(job));
+			});
 	});
 }
 
 void GoalPredictor::ResetLocalState(GameKey newGameKey) {
 	gameDataTracker.Clear();
-	pendingPredictions.WaitAllAndClear();
+	playerRegistry.Clear();
+	respawnTimers.Clear();
+	CancelPendingPredictions();
 	currentGameKey = newGameKey;
+	// Recheck the key on the next tick rather than after the recheck interval, e.g. when we're re-enabled mid-game
+	nextGameKeyCheckEpochTimeMs = 0;
+	if (*recordSnapshots) {
+		UpdateSnapshotFile();
+	}
 
 	lastGameTimeMs = -1;
 	lastGameTimeWorldTimeMs = -1;
 	lastTickWorldTimeMs = -1;
+	lastGameTimeEpochTimeMs = -1;
 	inGoalReplay = false;
 }
 
+// Don't block the game thread on in-flight predictions, just make sure we ignore them.
+void GoalPredictor::CancelPendingPredictions() {
+	performanceStats.OnPredictionsDropped(pendingPredictions.GetNumPending());
+	pendingPredictions.Clear();
+	inferenceEngine.CancelBefore(pendingPredictions.GetGeneration());
+}
+
+// Points the snapshot recorder at the current game's file, so each game gets one file which is appended to if the
+// same game (e.g. a replay) is watched again.
+void GoalPredictor::UpdateSnapshotFile() {
+	if (!currentGameKey.IsActive()) {
+		snapshotRecorder.CloseFile();
+		return;
+	}
+
+	std::string fileName = currentGameKey.guid;
+	std::replace_if(fileName.begin(), fileName.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '-'; }, '_');
+	auto path = gameWrapper->GetDataFolder() / SNAPSHOT_FOLDER_NAME / (fileName + SNAPSHOT_FILE_EXTENSION);
+	snapshotRecorder.OpenFile(path);
+	LOG("Recording snapshots to {}", path.string());
+}
+
+void GoalPredictor::FlushLog(size_t maxRecords) {
+	FlushLogRecords(maxRecords, [this](std::string_view text) {
+		cvarManager->log(std::string(text));
+	});
+}
+
 void GoalPredictor::LogPredictionTime() {
 	if (!*logPredictionTime) {
 		return;
@@ -337,3 +667,102 @@ bool GoalPredictor::ShouldLogInputs() {
 		return false;
 	}
 }
+
+void GoalPredictor::LogRenderAllocations(uint64_t numAllocations) {
+	if (!*logRenderAllocations) {
+		return;
+	}
+
+	static double lastLogRenderAllocationsEpochTimeMs = 0;
+	double currentEpochTimeMs = GetCurrentEpochTimeMs();
+	if (currentEpochTimeMs - lastLogRenderAllocationsEpochTimeMs <= LOG_FREQUENCY_MS) {
+		return;
+	}
+	lastLogRenderAllocationsEpochTimeMs = currentEpochTimeMs;
+
+	LOG("Overlay heap allocations last frame: {}", numAllocations);
+}
+
+void GoalPredictor::DumpHookCosts() {
+	std::vector<const HookCost*> hooks;
+	for (const auto& hook : hookCosts.GetAll()) {
+		hooks.push_back(hook.get());
+	}
+	std::sort(hooks.begin(), hooks.end(), [](const HookCost* a, const HookCost* b) {
+		return a->totalNs > b->totalNs;
+	});
+
+	double seconds = hookCosts.GetSecondsSinceReset();
+	uint64_t totalNs = 0;
+	LOG("---- Hook costs over the last {:.0f} s: calls / calls per s / total ms / avg us / max us", seconds);
+	for (const HookCost* hook : hooks) {
+		uint64_t numCalls = hook->numCalls;
+		uint64_t hookTotalNs = hook->totalNs;
+		totalNs += hookTotalNs;
+		LOG("{:>38}: {} / {:.1f} / {:.2f} / {:.2f} / {:.2f}", hook->name, numCalls, numCalls / seconds, hookTotalNs / 1e6,
+			numCalls > 0 ? hookTotalNs / 1e3 / numCalls : 0.0, hook->maxNs / 1e3);
+	}
+	LOG("Total: {:.2f} ms of game thread time per second", totalNs / 1e6 / seconds);
+}
+
+// typeid names are "struct Prediction" on MSVC
+static std::string_view GetTypeDisplayName(std::type_index type) {
+	std::string_view name = type.name();
+	for (std::string_view prefix : { "struct ", "class " }) {
+		if (name.starts_with(prefix)) {
+			name.remove_prefix(prefix.size());
+		}
+	}
+	return name;
+}
+
+// The pending tasks' closures each hold a copy of their input, on top of the task set's own bookkeeping
+static size_t GetPendingPredictionsMemoryBytes(const TimedTaskSet<std::optional<Prediction>>& pendingPredictions) {
+	return pendingPredictions.GetMemoryUsageBytes() + pendingPredictions.GetNumPending() * sizeof(InferenceInput);
+}
+
+void GoalPredictor::SampleMemoryPeaks() {
+	for (const auto& series : gameDataTracker.GetTimeSeriesMemoryUsage()) {
+		memoryPeaks.Update(GetTypeDisplayName(series.type), series.bytes);
+	}
+	memoryPeaks.Update("tracker", gameDataTracker.GetMemoryUsageBytes());
+	memoryPeaks.Update("pending", GetPendingPredictionsMemoryBytes(pendingPredictions));
+}
+
+void GoalPredictor::DumpMemoryUsage() {
+	SampleMemoryPeaks();
+
+	LOG("---- Memory: current / peak since load");
+	if (auto process = GetProcessMemoryUsage()) {
+		LOG("Process resident (including the game): {:.1f} MB / {:.1f} MB",
+			process->residentBytes / 1048576.0, process->peakResidentBytes / 1048576.0);
+	}
+	LOG("ONNX Runtime session + arena: {:.1f} MB, measured when the model was loaded", inferenceEngine.GetSessionMemoryBytes() / 1048576.0);
+	LOG("Augmentation masks: {:.1f} KB", inferenceEngine.GetMaskMemoryBytes() / 1024.0);
+
+	auto trackerBytes = gameDataTracker.GetMemoryUsageBytes();
+	LOG("GameDataTracker: {:.1f} KB / {:.1f} KB", trackerBytes / 1024.0, memoryPeaks.Get("tracker") / 1024.0);
+	for (const auto& series : gameDataTracker.GetTimeSeriesMemoryUsage()) {
+		auto name = GetTypeDisplayName(series.type);
+		LOG("  {}: {} entries, {:.1f} KB / {:.1f} KB", name, series.numEntries, series.bytes / 1024.0, memoryPeaks.Get(name) / 1024.0);
+	}
+
+	LOG("Pending predictions: {}, {:.1f} KB / {:.1f} KB", pendingPredictions.GetNumPending(),
+		GetPendingPredictionsMemoryBytes(pendingPredictions) / 1024.0, memoryPeaks.Get("pending") / 1024.0);
+
+	// BakkesMod builds one atlas for every plugin's fonts, so only the emoji glyphs are ours
+	int atlasWidth = fontAtlasWidth, atlasHeight = fontAtlasHeight;
+	LOG("ImGui font atlas (shared with BakkesMod): {}x{}, {:.1f} KB as RGBA, {} emoji glyphs of ours",
+		atlasWidth, atlasHeight, atlasWidth * atlasHeight * 4 / 1024.0, emojiFontNumGlyphs.load());
+}
+
+void GoalPredictor::DumpLatencyHistograms() {
+	LOG("---- Latency (ms) by stage: count / min / p50 / p90 / p99 / p99.9 / max");
+	for (int stage = 0; stage < NUM_PIPELINE_STAGES; stage++) {
+		const auto& histogram = GetPipelineHistograms()[stage];
+		LOG("{:>13}: {} / {:.2f} / {:.2f} / {:.2f} / {:.2f} / {:.2f} / {:.2f}",
+			GetPipelineStageName((PipelineStage)stage), histogram.GetCount(), histogram.GetMinMs(),
+			histogram.GetPercentileMs(0.5), histogram.GetPercentileMs(0.9), histogram.GetPercentileMs(0.99),
+			histogram.GetPercentileMs(0.999), histogram.GetMaxMs());
+	}
+}
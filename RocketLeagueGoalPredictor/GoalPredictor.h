@@ -5,7 +5,16 @@
 #include "GameDataTracker.h"
 #include "GameEvents.h"
 #include "GuiBase.h"
+#include "HookCosts.h"
 #include "InferenceEngine.h"
+#include "InferencePool.h"
+#include "LatencyHistogram.h"
+#include "MemoryUsage.h"
+#include "PerformanceStats.h"
+#include "PlayerRegistry.h"
+#include "PredictionRateController.h"
+#include "RespawnTimers.h"
+#include "SnapshotRecorder.h"
 #include "TimedTaskSet.h"
 
 class GoalPredictor: public BakkesMod::Plugin::BakkesModPlugin, public PluginWindowBase, public SettingsWindowBase {
@@ -17,6 +26,9 @@ private:
 	std::shared_ptr<bool> showTitleBar;
 	std::shared_ptr<CVarWrapper> showTitleBarCvar;
 
+	std::shared_ptr<bool> showDiagnostics;
+	std::shared_ptr<CVarWrapper> showDiagnosticsCvar;
+
 	std::shared_ptr<int> opacityPct;
 	std::shared_ptr<CVarWrapper> opacityPctCvar;
 	const int DEFAULT_OPACITY = 50;
@@ -27,7 +39,7 @@ private:
 	std::shared_ptr<CVarWrapper> graphHistoryMsCvar;
 	const int DEFAULT_GRAPH_HISTORY = 5000;
 	const int MIN_GRAPH_HISTORY = 1000;
-	const int MAX_GRAPH_HISTORY = 9000;
+	const int MAX_GRAPH_HISTORY = 20 * 60 * 1000; // Long enough for a whole match with some overtime
 
 	std::shared_ptr<Augmentation> augmentation;
 	std::shared_ptr<CVarWrapper> augmentationCvar;
@@ -40,11 +52,57 @@ private:
 	std::shared_ptr<bool> logInputs; // GoalPredictor_LogInputs
 	std::shared_ptr<CVarWrapper> logInputsCvar;
 
+	std::shared_ptr<bool> logRenderAllocations; // GoalPredictor_LogRenderAllocations
+	std::shared_ptr<CVarWrapper> logRenderAllocationsCvar;
+
+	std::shared_ptr<int> inferenceThreads; // GoalPredictor_InferenceThreads
+	std::shared_ptr<CVarWrapper> inferenceThreadsCvar;
+	const int DEFAULT_INFERENCE_THREADS = 1;
+	const int MIN_INFERENCE_THREADS = 1;
+	const int MAX_INFERENCE_THREADS = 4;
+
+	std::shared_ptr<int> inferenceCores; // GoalPredictor_InferenceCores
+	std::shared_ptr<CVarWrapper> inferenceCoresCvar;
+
+	std::shared_ptr<bool> inferenceLowPriority; // GoalPredictor_InferenceLowPriority
+	std::shared_ptr<CVarWrapper> inferenceLowPriorityCvar;
+
+	std::shared_ptr<int> targetFps; // GoalPredictor_TargetFps
+	std::shared_ptr<CVarWrapper> targetFpsCvar;
+	const int DEFAULT_TARGET_FPS = 60;
+	const int MIN_TARGET_FPS = 20;
+	const int MAX_TARGET_FPS = 360;
+
+	std::shared_ptr<int> profileRuns; // GoalPredictor_ProfileRuns
+	std::shared_ptr<CVarWrapper> profileRunsCvar;
+	const int MAX_PROFILE_RUNS = 10000;
+
+	std::shared_ptr<bool> recordSnapshots; // GoalPredictor_RecordSnapshots
+	std::shared_ptr<CVarWrapper> recordSnapshotsCvar;
+
+	std::shared_ptr<bool> tracing; // GoalPredictor_Tracing
+	std::shared_ptr<CVarWrapper> tracingCvar;
+
 	// State
 	InferenceEngine inferenceEngine;
 	GameKey currentGameKey;
+	double nextGameKeyCheckEpochTimeMs = 0; // Set to 0 by hooks which may change the game key, to recheck it on the next Tick()
 	GameDataTracker gameDataTracker;
+	PlayerRegistry playerRegistry;
+	RespawnTimers respawnTimers;
 	TimedTaskSet<std::optional<Prediction>> pendingPredictions;
+	InferencePool inferencePool; // Declared after the state its jobs reference, so its lanes are joined first
+	PredictionRateController predictionRateController;
+	PerformanceStats performanceStats;
+	double lastTickEpochTimeMs = -1;
+	SnapshotRecorder snapshotRecorder;
+	HookCosts hookCosts;
+	MemoryPeaks memoryPeaks;
+	double nextMemorySampleEpochTimeMs = 0;
+	// Written by the render thread, for the memory report
+	std::atomic<int> fontAtlasWidth = 0;
+	std::atomic<int> fontAtlasHeight = 0;
+	std::atomic<int> emojiFontNumGlyphs = 0;
 
 	// GameDataTracker uses the Game Time domain, but for replays that is low resolution (30 FPS) so would cause jittery
 	// renders if used for graphing. Thus we track corresponding World Time (higher resolution) for the most recently
@@ -55,6 +113,7 @@ private:
 	double lastGameTimeMs; // last seen GameTimeMs value, in Game Time domain
 	double lastGameTimeWorldTimeMs; // the WorldTimeMs value corresponding to when we first saw lastGameTimeMs in Tick()
 	double lastTickWorldTimeMs; // the WorldTimeMs value of the last Tick() call
+	double lastGameTimeEpochTimeMs; // the EpochTimeMs value when we first saw lastGameTimeMs, to measure playback speed
 	bool inGoalReplay = false; // Replay of a goal during an online game, *not* related to watching a replay file
 
 	void onLoad() override;
@@ -62,17 +121,34 @@ private:
 
 	void LoadCVars();
 	void LoadModel();
+	void RestartInferencePool();
 	void LoadEventHooks();
+
+	// Hook an event like gameWrapper->HookEvent() / HookEventWithCaller(), but count the calls and time spent
+	template <typename F>
+	void HookEventTimed(const std::string& eventName, F&& callback);
+	template <typename T, typename F>
+	void HookEventWithCallerTimed(const std::string& eventName, F&& callback);
+
 	void LoadRenderer();
 
 	template <typename T>
-	inline void AddEvent(const T& event, OverlapOptions options = {});
+	inline bool AddEvent(const T& event, OverlapOptions options = {});
 
 	inline bool IsActive(bool assertGameLive = false);
 
 	void ResetLocalState(GameKey newGameKey = GAME_KEY_NONE);
+	void CancelPendingPredictions();
+	void UpdateSnapshotFile();
+	void FlushLog(size_t maxRecords);
 	void LogPredictionTime();
 	bool ShouldLogInputs();
+	void LogRenderAllocations(uint64_t numAllocations);
+	void DumpLatencyHistograms();
+	void DumpHookCosts();
+	void SampleMemoryPeaks();
+	void DumpMemoryUsage();
+	void RenderDiagnostics();
 
 public:
 	void RenderWindow() override;
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Running totals for one game event hook. Hooks run on the game thread, but the totals are read from the render
+// thread too, hence the atomics.
+struct HookCost {
+    std::string name;
+    std::atomic<uint64_t> numCalls = 0;
+    std::atomic<uint64_t> totalNs = 0;
+    std::atomic<uint64_t> maxNs = 0;
+
+    explicit HookCost(std::string name) : name(std::move(name)) {}
+
+    void Record(uint64_t durationNs) {
+        numCalls.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(durationNs, std::memory_order_relaxed);
+        if (durationNs > maxNs.load(std::memory_order_relaxed)) {
+            maxNs.store(durationNs, std::memory_order_relaxed); // Only the game thread records, so no need to CAS
+        }
+    }
+
+    void Reset() {
+        numCalls.store(0, std::memory_order_relaxed);
+        totalNs.store(0, std::memory_order_relaxed);
+        maxNs.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Call counts and time spent in each registered hook, to show how much of the game thread the plugin uses.
+// Hooks are all added while loading, before anything reads the counters, so the list itself needs no locking.
+class HookCosts {
+private:
+    std::vector<std::unique_ptr<HookCost>> hooks;
+    std::atomic<std::chrono::steady_clock::rep> resetTime = std::chrono::steady_clock::now().time_since_epoch().count();
+
+public:
+    // The returned reference stays valid for the lifetime of this object.
+    HookCost& Add(std::string name) {
+        hooks.push_back(std::make_unique<HookCost>(std::move(name)));
+        return *hooks.back();
+    }
+
+    const std::vector<std::unique_ptr<HookCost>>& GetAll() const {
+        return hooks;
+    }
+
+    // Real time covered by the counters, to turn them into rates.
+    double GetSecondsSinceReset() const {
+        auto elapsed = std::chrono::steady_clock::now().time_since_epoch().count() - resetTime.load(std::memory_order_relaxed);
+        return std::chrono::duration<double>(std::chrono::steady_clock::duration(elapsed)).count();
+    }
+
+    void Reset() {
+        for (auto& hook : hooks) {
+            hook->Reset();
+        }
+        resetTime.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+};
+
+// Records the time from construction to destruction against a hook.
+class ScopedHookTimer {
+private:
+    HookCost& cost;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+public:
+    explicit ScopedHookTimer(HookCost& cost) : cost(cost) {}
+
+    ScopedHookTimer(const ScopedHookTimer&) = delete;
+    ScopedHookTimer& operator=(const ScopedHookTimer&) = delete;
+
+    ~ScopedHookTimer() {
+        auto duration = std::chrono::steady_clock::now() - startTime;
+        cost.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    }
+};
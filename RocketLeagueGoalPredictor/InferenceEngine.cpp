@@ -1,34 +1,34 @@
-#include "pch.h"
 #include "InferenceEngine.h"
-#include "logging.h"
-#include "utils.h"
+#include "FeatureBuilder.h"
+#include "LatencyHistogram.h"
+#include "LogSink.h"
+#include "MemoryUsage.h"
+#include "OrtProfileSummary.h"
+#include "Tracer.h"
 #include <algorithm>
-#include <numbers>
-#include <ranges>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 
-const int INPUT_DIM = 114;
-const int OUTPUT_DIM = 3;
-const int NUM_BALL_COLS = 6;
-const int NUM_PLAYER_COLS = 17;
-
-const double BIG_BOOST_RESPAWN_PERIOD_MS = 10 * 1000;
-const double PLAYER_RESPAWN_PERIOD_MS = 3 * 1000;
-const double EVENT_LOOKUP_GRACE_MS = 100;
-const double NEAR_ZERO_SECONDS_UNRELIABLE_THRESHOLD_SEC = 10;
-
-const float DEG_TO_RAD = static_cast<float>(std::numbers::pi / 180);
-
-void InferenceEngine::InitializeInternal(const std::string& model_path_str) {
-    env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "GoalPredictor");
+// The full table goes to the summary file, the console only gets the top of it
+static const size_t MAX_PROFILE_LOG_ROWS = 15;
 
+Ort::SessionOptions InferenceEngine::CreateSessionOptions() const {
     Ort::SessionOptions session_options;
     session_options.SetIntraOpNumThreads(1);
     session_options.SetInterOpNumThreads(1);
     session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
     session_options.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+    return session_options;
+}
+
+void InferenceEngine::InitializeInternal(const std::string& model_path_str) {
+    env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "GoalPredictor");
 
-    std::filesystem::path model_path = model_path_str;
-    session = std::make_unique<Ort::Session>(env, model_path.c_str(), session_options);
+    model_path = model_path_str;
+    session = std::make_unique<Ort::Session>(env, model_path.c_str(), CreateSessionOptions());
+    backend_name = "ONNX Runtime " + Ort::GetVersionString() + " (CPU)";
 
     size_t num_input_nodes = session->GetInputCount();
     input_node_names.reserve(num_input_nodes);
@@ -53,14 +53,6 @@ void InferenceEngine::InitializeInternal(const std::string& model_path_str) {
     InitializeMasks();
 }
 
-inline int player_col_index(int player_i, int player_col_i) {
-    return NUM_BALL_COLS + NUM_PLAYER_COLS * player_i + player_col_i;
-}
-
-inline int boost_index(int boost_i) {
-    return NUM_BALL_COLS + NUM_PLAYER_COLS * 6 + boost_i;
-}
-
 void InferenceEngine::InitializeMasks() {
     mask_flip_x.assign(INPUT_DIM, 1.0f);
     mask_flip_y.assign(INPUT_DIM, 1.0f);
@@ -95,11 +87,13 @@ void InferenceEngine::InitializeMasks() {
 
 bool InferenceEngine::Initialize(const std::string& model_path_str) {
     try {
+        auto memoryBefore = GetProcessMemoryUsage();
         InitializeInternal(model_path_str);
 
         // Run a test inference to make sure it works
         std::vector<float> test_input(INPUT_DIM, 0.0f);
-        auto out_ptr = InferRaw(test_input);
+        std::vector<float> out_ptr;
+        InferRaw(test_input, out_ptr, Ort::RunOptions(), *session);
         if (out_ptr.empty()) {
             LOG("Failed to make a test prediction with this model.");
             return false;
@@ -108,6 +102,12 @@ bool InferenceEngine::Initialize(const std::string& model_path_str) {
             LOG("Got nan value from test prediction with this model.");
             return false;
         }
+
+        // The arena grows on the first run, so measure after the test inference
+        auto memoryAfter = GetProcessMemoryUsage();
+        if (memoryBefore && memoryAfter && memoryAfter->residentBytes > memoryBefore->residentBytes) {
+            session_memory_bytes = memoryAfter->residentBytes - memoryBefore->residentBytes;
+        }
     }
     catch (const Ort::Exception& e) {
         LOG("Failed to load and test goal prediction model.");
@@ -123,6 +123,22 @@ void InferenceEngine::Deinitialize() {
     initialized = false;
 }
 
+bool InferenceEngine::IsInitialized() const {
+    return initialized && session;
+}
+
+const std::string& InferenceEngine::GetBackendName() const {
+    return backend_name;
+}
+
+size_t InferenceEngine::GetSessionMemoryBytes() const {
+    return session_memory_bytes;
+}
+
+size_t InferenceEngine::GetMaskMemoryBytes() const {
+    return (mask_flip_x.capacity() + mask_flip_y.capacity() + mask_flip_xy.capacity()) * sizeof(float);
+}
+
 inline static void ApplyMask(const float* input, const float* mask, float* output, bool swap_teams = false) {
     for (size_t i = 0; i < INPUT_DIM; ++i) {
         output[i] = input[i] * mask[i];
@@ -156,290 +172,313 @@ inline static void SwapBoostXY(float* data) {
     std::swap(boosts[2], boosts[3]);
 }
 
-inline static std::optional<double> GetKickoffTimeMs(const GameDataTracker& gameDataTracker, double currentTimeMs) {
-    auto latestGoalTimeMs = gameDataTracker.GetMostRecentTimeMs<GoalEvent>(currentTimeMs);
-    auto latestCountdownTimeMs = gameDataTracker.GetMostRecentTimeMs<KickoffEvent>(currentTimeMs);
-
-    if (!latestGoalTimeMs && !latestCountdownTimeMs) {
-        return std::nullopt;
-    }
-    else {
-        return std::max(latestGoalTimeMs.value_or(-1), latestCountdownTimeMs.value_or(-1));
+void InferenceEngine::BuildAugmentedRows(const float* input, Augmentation augmentation, float* output) const {
+    // Depending on augmentation, construct batches up to:
+    // 1. Identity  2. flip_xy  3. flip_x  4. flip_y
+    switch (augmentation) {
+    case AUGMENT_4X:
+        ApplyMask(input, mask_flip_y.data(), output + 3 * INPUT_DIM, true);
+        SwapBoostY(output + 3 * INPUT_DIM);
+        ApplyMask(input, mask_flip_x.data(), output + 2 * INPUT_DIM);
+        SwapBoostX(output + 2 * INPUT_DIM);
+        [[fallthrough]];
+    case AUGMENT_2X:
+        ApplyMask(input, mask_flip_xy.data(), output + 1 * INPUT_DIM, true);
+        SwapBoostXY(output + 1 * INPUT_DIM);
+        [[fallthrough]];
+    case NO_AUGMENT:
+        std::copy_n(input, INPUT_DIM, output);
     }
 }
 
-inline static float GetRespawnTimerSec(double eventTimeMs, double currentTimeMs, double respawnPeriodMs) {
-    auto respawnTimeMs = eventTimeMs + respawnPeriodMs;
-    auto timeToRespawnMs = std::min(currentTimeMs - respawnTimeMs, 0.0);
-    return static_cast<float>(timeToRespawnMs / 1000);
-}
-
-static std::string getSubarrayString(const std::vector<float>& data, size_t i, size_t L, int resolution = 3) {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(resolution);
-
-    oss << "[";
-    for (size_t j = 0; j < L; ++j) {
-        oss << data[i + j];
-        if (j % 3 == 2 && j < L - 1) {
-            oss << " || ";
-        } else if (j < L - 1) {
-            oss << ", ";
-        }
+// The output is N sets of three, each [prob_blue, prob_orange, prob_neither].
+// Average results from the N inferences, swapping teams on outputs from y flips
+static void AverageAugmentedOutputs(const float* output, Augmentation augmentation, float& prob_blue, float& prob_orange) {
+    prob_blue = 0.0;
+    prob_orange = 0.0;
+    switch (augmentation) {
+    case AUGMENT_4X:
+        prob_blue += output[10] + output[6];
+        prob_orange += output[9] + output[7];
+        [[fallthrough]];
+    case AUGMENT_2X:
+        prob_blue += output[4];
+        prob_orange += output[3];
+        [[fallthrough]];
+    case NO_AUGMENT:
+        prob_blue += output[0];
+        prob_orange += output[1];
     }
-    oss << "]";
+    prob_blue /= (int)augmentation;
+    prob_orange /= (int)augmentation;
+}
 
-    return oss.str();
+static double MillisecondsSince(std::chrono::steady_clock::time_point startTime) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 }
 
-std::optional<InferenceInput> InferenceEngine::GetInferenceInput(ServerWrapper server, const GameDataTracker& gameDataTracker, double currentTimeMs, bool logInputs) {
-    if (!initialized || !session || !server || server.IsNull() || !server.GetbRoundActive()) {
+// Run the model to make our predictions, optionally augmenting the data and averaging the results.
+std::optional<Prediction> InferenceEngine::Predict(const InferenceInput& input, Augmentation augmentation, uint64_t generation, PredictBuffers& buffers) {
+    ScopedTrace trace("Predict");
+    auto tensorBuildStartTime = std::chrono::steady_clock::now();
+    auto& batch_input = buffers.batch_input;
+    auto& batch_output = buffers.batch_output;
+    batch_input.resize((int)augmentation * INPUT_DIM);
+    batch_output.clear();
+    BuildAugmentedRows(input.inputs.data(), augmentation, batch_input.data());
+    GetPipelineHistograms()[STAGE_TENSOR_BUILD].Record(std::chrono::steady_clock::now() - tensorBuildStartTime);
+
+    // Register the run so CancelBefore() can terminate it, unless it's already been cancelled before starting.
+    Ort::RunOptions runOptions;
+    ActiveRunRegistration activeRun(*this, generation, runOptions);
+    if (!activeRun.IsRegistered()) {
         return std::nullopt;
     }
 
-    std::vector<float> inputs(INPUT_DIM, 0.0f);
-
-    auto ball = server.GetBall();
-    // GetExplosionTime() only set during PostGoalScored time (not to be confused with post-goal ReplayPlayback)
-    if (ball.IsNull() || ball.GetExplosionTime() > 0) {
-        return std::nullopt;
+    auto profiledSession = BeginProfiledRun();
+    auto startTime = std::chrono::steady_clock::now();
+    try {
+        InferRaw(batch_input, batch_output, runOptions, profiledSession ? *profiledSession : *session);
     }
-
-    auto ballPos = ball.GetCurrentRBState().Location;
-    auto ballVel = ball.GetCurrentRBState().LinearVelocity;
-    // Negate x-values to make them match a normal 3d space for viewers, though doesn't actually matter for inference since we augment anyway
-    inputs[0] = -ballPos.X;
-    inputs[1] = ballPos.Y;
-    inputs[2] = ballPos.Z;
-    inputs[3] = -ballVel.X;
-    inputs[4] = ballVel.Y;
-    inputs[5] = ballVel.Z;
-    if (logInputs) {
-        LOG("---- Model inputs at game time {}", currentTimeMs);
-        LOG("BALL: {}", getSubarrayString(inputs, 0, 6));
-    }
-
-    // Load in stored big boost and demo data to infer respawn timers.
-    auto mostRecentKickoffTimeMs = GetKickoffTimeMs(gameDataTracker, currentTimeMs);
-
-    auto boostPickupMinTimeMs = currentTimeMs - (BIG_BOOST_RESPAWN_PERIOD_MS + EVENT_LOOKUP_GRACE_MS);
-    boostPickupMinTimeMs = std::max(boostPickupMinTimeMs, mostRecentKickoffTimeMs.value_or(boostPickupMinTimeMs));
-    auto boostPickupEvents = gameDataTracker.GetRangeInclusive<BigBoostPickupEvent>(boostPickupMinTimeMs, currentTimeMs);
-
-    auto demolitionMinTimeMs = currentTimeMs - (PLAYER_RESPAWN_PERIOD_MS + EVENT_LOOKUP_GRACE_MS);
-    demolitionMinTimeMs = std::max(demolitionMinTimeMs, mostRecentKickoffTimeMs.value_or(demolitionMinTimeMs));
-    auto demolitionEvents = gameDataTracker.GetRangeInclusive<DemolitionEvent>(demolitionMinTimeMs, currentTimeMs);
-
-    auto PRIs = server.GetPRIs();
-    int num_team0_found = 0;
-    int num_team1_found = 0;
-    for (int i = 0; i < PRIs.Count(); ++i) {
-        PriWrapper pri = PRIs.Get(i);
-        if (pri.IsNull() || pri.IsSpectator() || pri.GetTeamNum() > 1) {
-            continue;
-        }
-
-        int p_index = 0;
-        if (pri.GetTeamNum() == 0) {
-            p_index = num_team0_found;
-            num_team0_found += 1;
-        }
-        else {
-            p_index = 3 + num_team1_found;
-            num_team1_found += 1;
-        }
-
-        auto car = pri.GetCar();
-        if (car.IsNull() || car.GetbHidden()) { // Demolished. Former case can occur when seeking forward in a replay, but usually it's latter case
-            // Set everything but respawn_timer to nan
-            std::fill(inputs.begin() + player_col_index(p_index, 0), inputs.begin() + player_col_index(p_index, NUM_PLAYER_COLS - 1), NAN);
-
-            // Hopefully infer respawn timer from our demo data
-            auto id = GetId(pri);
-            inputs[player_col_index(p_index, 16)] = -1.0f; // This is our default in case we can't find the demo event :shrug:
-            for (auto const& [timeMs, demolition] : demolitionEvents | std::views::reverse) {
-                if (id == demolition.victim_pri_id) {
-                    inputs[player_col_index(p_index, 16)] = GetRespawnTimerSec(timeMs, currentTimeMs, PLAYER_RESPAWN_PERIOD_MS);
-                    break;
-                }
-            }
-        }
-        else {
-            auto carPos = car.GetCurrentRBState().Location;
-            auto carVel = car.GetCurrentRBState().LinearVelocity;
-            auto [carRot, carUp] = RotatorToRotAndUpVectors(car.GetRotation());
-            auto carAngVel = car.GetCurrentRBState().AngularVelocity;
-
-            // Flip over x-axis to match a normal 3d space for viewers, though doesn't really matter here
-            inputs[player_col_index(p_index, 0)] = -carPos.X;
-            inputs[player_col_index(p_index, 1)] = carPos.Y;
-            inputs[player_col_index(p_index, 2)] = carPos.Z;
-            inputs[player_col_index(p_index, 3)] = -carVel.X;
-            inputs[player_col_index(p_index, 4)] = carVel.Y;
-            inputs[player_col_index(p_index, 5)] = carVel.Z;
-            inputs[player_col_index(p_index, 6)] = -carRot.X;
-            inputs[player_col_index(p_index, 7)] = carRot.Y;
-            inputs[player_col_index(p_index, 8)] = carRot.Z;
-            inputs[player_col_index(p_index, 9)] = -carUp.X;
-            inputs[player_col_index(p_index, 10)] = carUp.Y;
-            inputs[player_col_index(p_index, 11)] = carUp.Z;
-            // Negate angvel_[yz] when flipping over x-axis
-            // Convert angvel from deg / sec to rad / sec which the model expects
-            inputs[player_col_index(p_index, 12)] = carAngVel.X * DEG_TO_RAD;
-            inputs[player_col_index(p_index, 13)] = -carAngVel.Y * DEG_TO_RAD;
-            inputs[player_col_index(p_index, 14)] = -carAngVel.Z * DEG_TO_RAD;
-            inputs[player_col_index(p_index, 15)] = !car.GetBoostComponent().IsNull()
-                ? 100 * car.GetBoostComponent().GetPercentBoostFull()
-                : 0.0f;
-            inputs[player_col_index(p_index, 16)] = NAN; // respawn_timer
-        }
-
-        if (logInputs) {
-            LOG("P{} ({}): {}", p_index, pri.GetPlayerName().ToString(), getSubarrayString(inputs, player_col_index(p_index, 0), NUM_PLAYER_COLS));
+    catch (const Ort::Exception& e) {
+        batch_output.clear();
+        std::lock_guard lock(activeRunsMutex);
+        if (generation >= minActiveGeneration) {
+            LOG("Inference error!");
+            LOG(e.what());
         }
     }
-
-    if (num_team0_found != 3 || num_team1_found != 3) {
-        return std::nullopt;
-    }
-
-    // Hopefully infer boost respawn timers from pickup events
-    std::fill(inputs.begin() + boost_index(0), inputs.begin() + boost_index(6), NAN); // Set to NAN as default which indicates boost is live
-    for (auto const& [timeMs, boostPickup] : boostPickupEvents | std::views::reverse) {
-        auto index = boost_index(boostPickup.boost_index);
-        if (std::isnan(inputs[index])) {
-            inputs[index] = GetRespawnTimerSec(timeMs, currentTimeMs, BIG_BOOST_RESPAWN_PERIOD_MS);
-        }
+    double predictionTimeMs = MillisecondsSince(startTime);
+    if (profiledSession) {
+        EndProfiledRun();
     }
 
-    if (logInputs) {
-        LOG("BOOSTS: {}", getSubarrayString(inputs, boost_index(0), 6));
+    bool cancelled = activeRun.Finish(generation);
+    if (cancelled || batch_output.empty()) {
+        return std::nullopt;
     }
 
-    PredictionReliability reliability = server.GetSecondsRemaining() > NEAR_ZERO_SECONDS_UNRELIABLE_THRESHOLD_SEC || server.GetbOverTime()
-        ? RELIABLE
-        : UNRELIABLE_NEAR_ZERO_SECONDS;
-    // No more UNRELIABLE_MISSING_PAST_DATA checks anymore since it's uncommon, only induces minor changes, and is kinda confusing UX.
-
-    return InferenceInput{ inputs, reliability };
+    float prob_blue, prob_orange;
+    AverageAugmentedOutputs(batch_output.data(), augmentation, prob_blue, prob_orange);
+    return Prediction(prob_blue, prob_orange, input.reliability, augmentation, predictionTimeMs);
 }
 
-// Run the model to make our predictions, optionally augmenting the data and averaging the results.
-std::optional<Prediction> InferenceEngine::Predict(InferenceInput input, Augmentation augmentation) {
-    auto augmentationNum = (int)augmentation;
-    std::vector<float> batch_input(augmentationNum * INPUT_DIM, 0.0f);
-    float* batch_input_ptr = batch_input.data();
-    const float* input_ptr = input.inputs.data();
+bool InferenceEngine::PredictBatch(const float* inputs, const PredictionReliability* reliabilities, size_t numRows, Augmentation augmentation,
+        PredictBuffers& buffers, std::vector<Prediction>& predictions) {
+    ScopedTrace trace("PredictBatch");
+    BuildBatchInput(inputs, numRows, augmentation, buffers.batch_input);
+    return RunBatch(buffers.batch_input, reliabilities, augmentation, buffers.batch_output, predictions);
+}
 
-    // Depending on augmentation, construct batches up to:
-    // 1. Identity  2. flip_xy  3. flip_x  4. flip_y
-    switch (augmentation) {
-    case AUGMENT_4X:
-        ApplyMask(input_ptr, mask_flip_y.data(), batch_input_ptr + 3 * INPUT_DIM, true);
-        SwapBoostY(batch_input_ptr + 3 * INPUT_DIM);
-        ApplyMask(input_ptr, mask_flip_x.data(), batch_input_ptr + 2 * INPUT_DIM);
-        SwapBoostX(batch_input_ptr + 2 * INPUT_DIM);
-        [[fallthrough]];
-    case AUGMENT_2X:
-        ApplyMask(input_ptr, mask_flip_xy.data(), batch_input_ptr + 1 * INPUT_DIM, true);
-        SwapBoostXY(batch_input_ptr + 1 * INPUT_DIM);
-        [[fallthrough]];
-    case NO_AUGMENT:
-        std::copy_n(input_ptr, INPUT_DIM, batch_input_ptr);
+void InferenceEngine::BuildBatchInput(const float* inputs, size_t numRows, Augmentation augmentation, std::vector<float>& batchInput) const {
+    ScopedStageTimer timer(STAGE_TENSOR_BUILD);
+    size_t rowsPerInput = (size_t)augmentation;
+    batchInput.resize(numRows * rowsPerInput * INPUT_DIM);
+    for (size_t i = 0; i < numRows; i++) {
+        BuildAugmentedRows(inputs + i * INPUT_DIM, augmentation, batchInput.data() + i * rowsPerInput * INPUT_DIM);
     }
+}
 
-    auto startTimeMs = GetCurrentEpochTimeMs();
-    const std::vector<float> batch_output = InferRaw(batch_input);
-    auto endTimeMs = GetCurrentEpochTimeMs();
-    if (batch_output.empty()) {
-        return std::nullopt;
+bool InferenceEngine::RunBatch(std::vector<float>& batchInput, const PredictionReliability* reliabilities, Augmentation augmentation,
+        std::vector<float>& batchOutput, std::vector<Prediction>& predictions) {
+    predictions.clear();
+    size_t rowsPerInput = (size_t)augmentation;
+    size_t numRows = batchInput.size() / (rowsPerInput * INPUT_DIM);
+    if (numRows == 0) {
+        return true;
     }
 
-    // The output is N sets of three, each [prob_blue, prob_orange, prob_neither].
-    // Average results from the N inferences, swapping teams on outputs from y flips
-    float prob_blue = 0.0, prob_orange = 0.0;
-    switch (augmentation) {
-    case AUGMENT_4X:
-        prob_blue += batch_output[10] + batch_output[6];
-        prob_orange += batch_output[9] + batch_output[7];
-        [[fallthrough]];
-    case AUGMENT_2X:
-        prob_blue += batch_output[4];
-        prob_orange += batch_output[3];
-        [[fallthrough]];
-    case NO_AUGMENT:
-        prob_blue += batch_output[0];
-        prob_orange += batch_output[1];
+    auto profiledSession = BeginProfiledRun();
+    auto startTime = std::chrono::steady_clock::now();
+    try {
+        InferRaw(batchInput, batchOutput, Ort::RunOptions(), profiledSession ? *profiledSession : *session);
+    }
+    catch (const Ort::Exception& e) {
+        batchOutput.clear();
+        LOG("Inference error!");
+        LOG(e.what());
+    }
+    double batchTimeMs = MillisecondsSince(startTime);
+    if (profiledSession) {
+        EndProfiledRun();
+    }
+    if (batchOutput.empty()) {
+        return false;
     }
-    prob_blue /= augmentationNum;
-    prob_orange /= augmentationNum;
 
-    return Prediction(prob_blue, prob_orange, input.reliability, augmentation, endTimeMs - startTimeMs);
+    predictions.reserve(numRows);
+    for (size_t i = 0; i < numRows; i++) {
+        float prob_blue, prob_orange;
+        AverageAugmentedOutputs(batchOutput.data() + i * rowsPerInput * OUTPUT_DIM, augmentation, prob_blue, prob_orange);
+        predictions.emplace_back(prob_blue, prob_orange, reliabilities[i], augmentation, batchTimeMs);
+    }
+    return true;
 }
 
-const std::vector<float> InferenceEngine::InferRaw(std::vector<float> input) {
+void InferenceEngine::InferRaw(std::vector<float>& input, std::vector<float>& output, const Ort::RunOptions& runOptions, Ort::Session& runSession) {
+    output.clear();
     if (input.size() % INPUT_DIM != 0) {
-        return {};
+        return;
     }
-    int num_batches = static_cast<int>(input.size() / INPUT_DIM);
-    std::vector<int64_t> batch_input_dims = { num_batches, INPUT_DIM };
-
-    try {
-        Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-            cpu_memory_info,
-            input.data(),
-            input.size(),
-            batch_input_dims.data(),
-            batch_input_dims.size()
-        );
-
-        auto output_tensors = session->Run(
-            Ort::RunOptions { nullptr },
+    int64_t num_batches = static_cast<int64_t>(input.size() / INPUT_DIM);
+    // Shapes on the stack, and the output tensor bound over the caller's reused buffer, so once the buffers have grown
+    // to size nothing here allocates; ONNX Runtime only creates its small tensor handles.
+    std::array<int64_t, 2> batch_input_dims = { num_batches, INPUT_DIM };
+    std::array<int64_t, 2> batch_output_dims = { num_batches, OUTPUT_DIM };
+    output.resize(num_batches * OUTPUT_DIM);
+
+    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
+        cpu_memory_info,
+        input.data(),
+        input.size(),
+        batch_input_dims.data(),
+        batch_input_dims.size()
+    );
+    Ort::Value output_tensor = Ort::Value::CreateTensor<float>(
+        cpu_memory_info,
+        output.data(),
+        output.size(),
+        batch_output_dims.data(),
+        batch_output_dims.size()
+    );
+
+    {
+        ScopedStageTimer timer(STAGE_SESSION_RUN);
+        ScopedTrace trace("SessionRun");
+        runSession.Run(
+            runOptions,
             input_node_names_ptr.data(),
             &input_tensor,
             1,
             output_node_names_ptr.data(),
+            &output_tensor,
             1
         );
+    }
 
-        auto out_ptr = output_tensors[0].GetTensorData<float>();
-        auto out_vector = std::vector<float>(out_ptr, out_ptr + num_batches * OUTPUT_DIM);
+    // Ensure outputs are not nan / infty and in correct range
+    for (auto val : output) {
+        if (!(val >= 0.0f && val <= 1.0f)) {
+            LOG("INVALID MODEL OUTPUT: {}", val);
+            output.clear();
+            return;
+        }
+    }
+}
 
-        // Ensure outputs are not nan / infty and in correct range
-        for (auto val : out_vector) {
-            if (!(val >= 0.0f && val <= 1.0f)) {
-                LOG("INVALID MODEL OUTPUT: {}", val);
-                return {};
-            }
+InferenceEngine::ActiveRunRegistration::ActiveRunRegistration(InferenceEngine& engine, uint64_t generation, Ort::RunOptions& runOptions)
+    : engine(engine), runOptions(runOptions) {
+    std::lock_guard lock(engine.activeRunsMutex);
+    registered = generation >= engine.minActiveGeneration;
+    if (registered) {
+        engine.activeRuns.push_back({ generation, &runOptions });
+    }
+}
+
+InferenceEngine::ActiveRunRegistration::~ActiveRunRegistration() {
+    if (registered) {
+        std::lock_guard lock(engine.activeRunsMutex);
+        std::erase_if(engine.activeRuns, [&](const auto& run) { return run.second == &runOptions; });
+    }
+}
+
+bool InferenceEngine::ActiveRunRegistration::Finish(uint64_t generation) {
+    std::lock_guard lock(engine.activeRunsMutex);
+    if (registered) {
+        std::erase_if(engine.activeRuns, [&](const auto& run) { return run.second == &runOptions; });
+        registered = false;
+    }
+    return generation < engine.minActiveGeneration;
+}
+
+void InferenceEngine::CancelBefore(uint64_t generation) {
+    std::lock_guard lock(activeRunsMutex);
+    minActiveGeneration = std::max(minActiveGeneration, generation);
+    for (auto& [runGeneration, runOptions] : activeRuns) {
+        if (runGeneration < minActiveGeneration) {
+            runOptions->SetTerminate();
         }
+    }
+}
+
+bool InferenceEngine::StartProfiling(int numRuns, const std::filesystem::path& outputPrefix) {
+    if (!IsInitialized() || numRuns <= 0) {
+        return false;
+    }
 
-        return out_vector;
+    std::lock_guard lock(profilingMutex);
+    if (profilingSession) {
+        return false;
+    }
+
+    try {
+        auto session_options = CreateSessionOptions();
+        session_options.EnableProfiling(outputPrefix.c_str());
+        profilingSession = std::make_shared<Ort::Session>(env, model_path.c_str(), session_options);
     }
     catch (const Ort::Exception& e) {
-        LOG("Inference error!");
+        LOG("Failed to create profiling session.");
         LOG(e.what());
-        return {};
+        return false;
     }
+    profileRunsToStart = numRuns;
+    profileRunsToFinish = numRuns;
+    profiling = true;
+    return true;
 }
 
-std::optional<int> InferenceEngine::GetBigBoostIndex(Vector location) {
-    // Unlike above, we do *not* negate x-values here to make them match a normal x-y space
-    // we just leave them in pure game coordinates, and assume the location is as well.
-    static const Vector BIG_BOOST_LOCATIONS[6] = {
-        {  3072.0f, -4096.0f, 72.0f},
-        { -3072.0f, -4096.0f, 72.0f},
-        {  3584.0f,     0.0f, 72.0f},
-        { -3584.0f,     0.0f, 72.0f},
-        {  3072.0f,  4096.0f, 72.0f},
-        { -3072.0f,  4096.0f, 72.0f},
-    };
-    static const float EPSILON = 1.0f;
+bool InferenceEngine::IsProfiling() const {
+    return profiling;
+}
 
-    for (int i = 0; i < 6; i++) {
-        if ((BIG_BOOST_LOCATIONS[i] - location).magnitude() < EPSILON) {
-            return i;
+std::shared_ptr<Ort::Session> InferenceEngine::BeginProfiledRun() {
+    if (!profiling) {
+        return nullptr;
+    }
+
+    std::lock_guard lock(profilingMutex);
+    if (profileRunsToStart <= 0) {
+        return nullptr;
+    }
+    profileRunsToStart--;
+    return profilingSession;
+}
+
+void InferenceEngine::EndProfiledRun() {
+    std::shared_ptr<Ort::Session> finishedSession;
+    {
+        std::lock_guard lock(profilingMutex);
+        if (--profileRunsToFinish > 0) {
+            return;
         }
+        finishedSession = std::move(profilingSession);
     }
 
-    return std::nullopt;
+    try {
+        auto profileFile = finishedSession->EndProfilingAllocated(allocator);
+        std::filesystem::path profilePath = std::u8string(reinterpret_cast<const char8_t*>(profileFile.get()));
+        auto summary = SummarizeOrtProfile(profilePath);
+        if (!summary) {
+            LOG("Failed to read model profile {}", profilePath.string());
+        }
+        else {
+            auto summaryPath = profilePath;
+            summaryPath.replace_extension();
+            summaryPath += "_summary.txt";
+            std::ofstream summaryFile(summaryPath);
+            LOG("---- Model profile, slowest nodes by total kernel time:");
+            for (const auto& line : FormatOrtProfileSummary(*summary, MAX_PROFILE_LOG_ROWS)) {
+                LOG("{}", line);
+            }
+            for (const auto& line : FormatOrtProfileSummary(*summary, summary->operators.size())) {
+                summaryFile << line << "\n";
+            }
+            LOG("Wrote model profile to {} and {}", profilePath.string(), summaryPath.string());
+        }
+    }
+    catch (const Ort::Exception& e) {
+        LOG("Failed to end model profiling.");
+        LOG(e.what());
+    }
+    profiling = false;
 }
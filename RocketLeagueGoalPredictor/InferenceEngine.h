@@ -1,17 +1,27 @@
 #pragma once
 
-#include "GameDataTracker.h"
+#include "FeatureBuilder.h"
 #include "GameEvents.h"
+#include <atomic>
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <onnxruntime/onnxruntime_cxx_api.h>
 #include <string>
 #include <vector>
 
 struct InferenceInput {
-    std::vector<float> inputs;
+    FeatureVector inputs;
     PredictionReliability reliability;
 };
 
+// Scratch buffers for one prediction at a time, reused across predictions so they don't reallocate each run.
+struct PredictBuffers {
+    std::vector<float> batch_input;
+    std::vector<float> batch_output;
+};
+
 class InferenceEngine {
 private:
     bool initialized;
@@ -22,28 +32,103 @@ private:
     Ort::AllocatorWithDefaultOptions allocator;
     Ort::MemoryInfo cpu_memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
 
+    std::string backend_name;
+    size_t session_memory_bytes = 0;
+
     // Model Info
     std::vector<std::string> input_node_names;
     std::vector<std::string> output_node_names;
     std::vector<const char*> input_node_names_ptr;
     std::vector<const char*> output_node_names_ptr;
 
+    // In-flight runs by generation, so stale ones can be terminated
+    std::mutex activeRunsMutex;
+    std::vector<std::pair<uint64_t, Ort::RunOptions*>> activeRuns;
+    uint64_t minActiveGeneration = 0;
+
+    // Keeps a run in activeRuns while it's in scope, so it's deregistered however the run ends and CancelBefore()
+    // never touches the options of a finished run.
+    class ActiveRunRegistration {
+    private:
+        InferenceEngine& engine;
+        Ort::RunOptions& runOptions;
+        bool registered;
+
+    public:
+        // Doesn't register runs from generations which have already been cancelled, see IsRegistered().
+        ActiveRunRegistration(InferenceEngine& engine, uint64_t generation, Ort::RunOptions& runOptions);
+        ActiveRunRegistration(const ActiveRunRegistration&) = delete;
+        ActiveRunRegistration& operator=(const ActiveRunRegistration&) = delete;
+        ~ActiveRunRegistration();
+
+        bool IsRegistered() const { return registered; }
+        // Deregisters the run early, returning whether it was cancelled while it ran.
+        bool Finish(uint64_t generation);
+    };
+
+    // Profiling session, used instead of the main one for the next few runs after StartProfiling()
+    std::filesystem::path model_path;
+    std::mutex profilingMutex;
+    std::shared_ptr<Ort::Session> profilingSession;
+    int profileRunsToStart = 0;
+    int profileRunsToFinish = 0;
+    std::atomic<bool> profiling = false;
+
     // Augmentation Masks
     std::vector<float> mask_flip_x;
     std::vector<float> mask_flip_y;
     std::vector<float> mask_flip_xy;
 
+    Ort::SessionOptions CreateSessionOptions() const;
+    // Writes the (int)augmentation augmented copies of one INPUT_DIM input to consecutive rows of output.
+    void BuildAugmentedRows(const float* input, Augmentation augmentation, float* output) const;
     void InitializeInternal(const std::string& model_path);
     void InitializeMasks();
 
-    const std::vector<float> InferRaw(std::vector<float> input);
+    // Writes the outputs into output, which is left empty if the model gave invalid outputs.
+    void InferRaw(std::vector<float>& input, std::vector<float>& output, const Ort::RunOptions& runOptions, Ort::Session& runSession);
+
+    // The profiling session if this run should be profiled, otherwise null.
+    std::shared_ptr<Ort::Session> BeginProfiledRun();
+    // Once the last profiled run finishes, writes out the profile and logs a summary of it.
+    void EndProfiledRun();
 
 public:
     bool Initialize(const std::string& model_path);
     void Deinitialize();
 
-    std::optional<InferenceInput> GetInferenceInput(ServerWrapper server, const GameDataTracker& gameDataTracker, double currentTimeMs, bool logInputs = false);
-    std::optional<Prediction> Predict(InferenceInput input, Augmentation augmentation);
+    bool IsInitialized() const;
+    // Human readable description of the runtime and execution provider, for diagnostics.
+    const std::string& GetBackendName() const;
+
+    // Growth in process memory across loading the model and running it once, i.e. the session, its weights and the
+    // arena after one run. Approximate, since other threads may allocate at the same time.
+    size_t GetSessionMemoryBytes() const;
+    size_t GetMaskMemoryBytes() const;
+
+    // Predictions are tagged with a generation so they can be cancelled in bulk, see CancelBefore().
+    // Safe to call concurrently from several threads as long as each uses its own buffers.
+    std::optional<Prediction> Predict(const InferenceInput& input, Augmentation augmentation, uint64_t generation, PredictBuffers& buffers);
+
+    // Predicts numRows consecutive INPUT_DIM rows with a single session run, for offline use where throughput matters
+    // more than latency. Each prediction takes its row's reliability, and gets the time taken by the whole run. Returns
+    // false, leaving predictions empty, if inference failed. Safe to call concurrently as long as each caller uses its
+    // own buffers.
+    bool PredictBatch(const float* inputs, const PredictionReliability* reliabilities, size_t numRows, Augmentation augmentation,
+        PredictBuffers& buffers, std::vector<Prediction>& predictions);
+    // The two halves of PredictBatch(), for pipelines which build and run batches as separate stages. RunBatch() takes
+    // a batchInput filled by BuildBatchInput() with the same augmentation, and uses batchOutput as scratch space.
+    void BuildBatchInput(const float* inputs, size_t numRows, Augmentation augmentation, std::vector<float>& batchInput) const;
+    bool RunBatch(std::vector<float>& batchInput, const PredictionReliability* reliabilities, Augmentation augmentation,
+        std::vector<float>& batchOutput, std::vector<Prediction>& predictions);
+
+    // Terminates any in-flight predictions from before this generation, and makes any that haven't started yet
+    // return nullopt immediately.
+    void CancelBefore(uint64_t generation);
 
-    static std::optional<int> GetBigBoostIndex(Vector location);
+    // Profiles the next numRuns predictions with a separate session, then logs the slowest nodes and writes ONNX
+    // Runtime's trace plus a summary table to files starting with outputPrefix. Returns false if it couldn't start,
+    // e.g. because profiling is already in progress.
+    bool StartProfiling(int numRuns, const std::filesystem::path& outputPrefix);
+    bool IsProfiling() const;
 };
\ No newline at end of file
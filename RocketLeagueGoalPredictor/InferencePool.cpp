@@ -0,0 +1,85 @@
+#include "InferencePool.h"
+#include "LogSink.h"
+#include "Tracer.h"
+
+void InferencePool::Start(int numLanes, ThreadQoS qos) {
+    Stop();
+
+    std::lock_guard lock(mutex);
+    stopping = false;
+    for (int i = 0; i < numLanes; i++) {
+        auto lane = std::make_unique<InferenceLane>();
+        lane->index = i;
+        lane->thread = std::thread(&InferencePool::RunLane, this, std::ref(*lane), qos);
+        lanes.push_back(std::move(lane));
+    }
+}
+
+void InferencePool::Stop() {
+    std::vector<std::unique_ptr<InferenceLane>> stoppedLanes;
+    std::deque<Job> discardedJobs;
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        stoppedLanes.swap(lanes);
+        discardedJobs.swap(jobs);
+    }
+    jobAvailable.notify_all();
+    discardedJobs.clear(); // Outside the lock, in case a job's destructor submits more work or waits on it
+
+    for (auto& lane : stoppedLanes) {
+        if (lane->thread.joinable()) {
+            lane->thread.join();
+        }
+    }
+}
+
+void InferencePool::RunLane(InferenceLane& lane, ThreadQoS qos) {
+    SetTraceThreadName("Inference");
+    if (!ApplyThreadQoS(qos)) {
+        LOG("Failed to apply thread affinity / priority to inference lane {}.", lane.index);
+    }
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            numBusyLanes++;
+        }
+
+        job(lane);
+
+        std::lock_guard lock(mutex);
+        numBusyLanes--;
+    }
+}
+
+void InferencePool::Submit(Job job) {
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+bool InferencePool::IsSaturated() const {
+    std::lock_guard lock(mutex);
+    int numLanes = static_cast<int>(lanes.size());
+    return numBusyLanes >= numLanes && static_cast<int>(jobs.size()) >= numLanes;
+}
+
+int InferencePool::GetNumLanes() const {
+    std::lock_guard lock(mutex);
+    return static_cast<int>(lanes.size());
+}
+
+InferencePool::~InferencePool() {
+    Stop();
+}
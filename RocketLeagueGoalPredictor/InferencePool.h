@@ -0,0 +1,50 @@
+#pragma once
+#include "InferenceEngine.h"
+#include "ThreadQoS.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One inference worker thread and its own buffers.
+struct InferenceLane {
+    int index;
+    PredictBuffers buffers;
+    std::thread thread;
+};
+
+// A fixed set of inference lanes sharing one job queue, so whichever lane is idle picks up the next prediction.
+// All lanes share the InferenceEngine's session, which ONNX Runtime allows to Run() concurrently.
+class InferencePool {
+public:
+    using Job = std::function<void(InferenceLane&)>;
+
+private:
+    std::vector<std::unique_ptr<InferenceLane>> lanes;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::deque<Job> jobs;
+    int numBusyLanes = 0;
+    bool stopping = false;
+
+    void RunLane(InferenceLane& lane, ThreadQoS qos);
+
+public:
+    // Restarts with numLanes lanes, each applying qos to itself when it starts.
+    void Start(int numLanes, ThreadQoS qos = {});
+    // Discards queued jobs which haven't started, waits for the running ones, then joins the lanes. Jobs are destroyed
+    // without being run, so anything waiting on them must notice that, e.g. from their destructors.
+    void Stop();
+
+    void Submit(Job job);
+
+    // Whether every lane is busy and already has a job waiting for it, so new work would just queue up.
+    bool IsSaturated() const;
+    int GetNumLanes() const;
+
+    ~InferencePool();
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+// Fixed memory, lock-free latency histogram with HDR-style log-linear buckets: exact below 64us, then 32 buckets per
+// power of two, so any recorded value is reported within ~3%. Record() may be called from any number of threads.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr uint64_t LINEAR_LIMIT = SUB_BUCKET_COUNT * 2; // Values below this get a bucket each
+    static constexpr int MAX_VALUE_BITS = 36; // ~19 hours in microseconds, anything longer is clamped
+    static constexpr int NUM_BUCKETS = LINEAR_LIMIT + (MAX_VALUE_BITS - (SUB_BUCKET_BITS + 1)) * SUB_BUCKET_COUNT;
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> minUs = UINT64_MAX;
+    std::atomic<uint64_t> maxUs = 0;
+
+    static int GetBucketIndex(uint64_t valueUs) {
+        if (valueUs < LINEAR_LIMIT) {
+            return static_cast<int>(valueUs);
+        }
+        int msb = std::min(static_cast<int>(std::bit_width(valueUs)) - 1, MAX_VALUE_BITS - 1);
+        int shift = msb - SUB_BUCKET_BITS;
+        uint64_t subBucket = std::min(valueUs >> shift, SUB_BUCKET_COUNT * 2 - 1);
+        return static_cast<int>(LINEAR_LIMIT + (msb - (SUB_BUCKET_BITS + 1)) * SUB_BUCKET_COUNT + (subBucket - SUB_BUCKET_COUNT));
+    }
+
+    // Middle of the range of values that land in this bucket
+    static double GetBucketValueUs(int index) {
+        if (index < static_cast<int>(LINEAR_LIMIT)) {
+            return index;
+        }
+        int group = (index - static_cast<int>(LINEAR_LIMIT)) / SUB_BUCKET_COUNT;
+        uint64_t subBucket = (index - LINEAR_LIMIT) % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+        int shift = group + 1;
+        return ((subBucket << shift) + ((subBucket + 1) << shift)) / 2.0;
+    }
+
+public:
+    void Record(uint64_t valueUs) {
+        buckets[GetBucketIndex(valueUs)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t currentMin = minUs.load(std::memory_order_relaxed);
+        while (valueUs < currentMin && !minUs.compare_exchange_weak(currentMin, valueUs, std::memory_order_relaxed)) {}
+        uint64_t currentMax = maxUs.load(std::memory_order_relaxed);
+        while (valueUs > currentMax && !maxUs.compare_exchange_weak(currentMax, valueUs, std::memory_order_relaxed)) {}
+    }
+
+    void Record(std::chrono::steady_clock::duration duration) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        Record(static_cast<uint64_t>(std::max<int64_t>(us, 0)));
+    }
+
+    uint64_t GetCount() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    double GetMinMs() const {
+        return GetCount() > 0 ? minUs.load(std::memory_order_relaxed) / 1000.0 : 0;
+    }
+
+    double GetMaxMs() const {
+        return maxUs.load(std::memory_order_relaxed) / 1000.0;
+    }
+
+    // Value at or below which the given fraction of recordings fall. Concurrent recordings may or may not be included.
+    double GetPercentileMs(double fraction) const {
+        uint64_t total = GetCount();
+        if (total == 0) {
+            return 0;
+        }
+
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * total + 0.5));
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                // Bucket midpoints can overshoot the true extremes, so clamp to what was actually seen
+                return std::clamp(GetBucketValueUs(i) / 1000.0, GetMinMs(), GetMaxMs());
+            }
+        }
+        return GetMaxMs();
+    }
+
+    // Not atomic as a whole, so recordings racing with a reset may be partially kept.
+    void Reset() {
+        for (auto& bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        count.store(0, std::memory_order_relaxed);
+        minUs.store(UINT64_MAX, std::memory_order_relaxed);
+        maxUs.store(0, std::memory_order_relaxed);
+    }
+};
+
+// The stages a prediction goes through, plus drawing the overlay.
+enum PipelineStage {
+    STAGE_CAPTURE, // Capturing the game snapshot and building features on the game thread
+    STAGE_QUEUE_WAIT, // From queueing a prediction until an inference lane picks it up
+    STAGE_TENSOR_BUILD, // Building the augmented input batch
+    STAGE_SESSION_RUN, // session->Run()
+    STAGE_RESULT_INSERT, // Adding a completed prediction to the GameDataTracker
+    STAGE_OVERLAY_DRAW, // Drawing the overlay window
+    NUM_PIPELINE_STAGES,
+};
+
+inline const char* GetPipelineStageName(PipelineStage stage) {
+    static const char* const NAMES[NUM_PIPELINE_STAGES] = {
+        "capture", "queue wait", "tensor build", "session run", "result insert", "overlay draw",
+    };
+    return NAMES[stage];
+}
+
+// Process-wide histograms for each pipeline stage, shared by the game, render and inference threads.
+inline std::array<LatencyHistogram, NUM_PIPELINE_STAGES>& GetPipelineHistograms() {
+    static std::array<LatencyHistogram, NUM_PIPELINE_STAGES> histograms;
+    return histograms;
+}
+
+// Records the time from construction to destruction into the given stage's histogram.
+class ScopedStageTimer {
+private:
+    PipelineStage stage;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+public:
+    explicit ScopedStageTimer(PipelineStage stage) : stage(stage) {}
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+    ~ScopedStageTimer() {
+        GetPipelineHistograms()[stage].Record(std::chrono::steady_clock::now() - startTime);
+    }
+};
@@ -0,0 +1,227 @@
+#include "LogSink.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <memory>
+
+static const size_t LOG_RING_CAPACITY = 512; // ~200 KB
+
+struct LogRecord {
+    // Vyukov bounded queue sequencing: equal to the slot's next push position when free, one past it when written
+    std::atomic<uint64_t> sequence;
+    size_t length;
+    char text[LOG_RECORD_MAX_LENGTH];
+};
+
+// Output iterator which writes into a fixed buffer and silently drops whatever doesn't fit. Advances in operator++
+// rather than on assignment, so *it++ = c moves the iterator itself and not just the copy it returns.
+template <typename CharT>
+struct TruncatingIterator {
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    CharT* out;
+    CharT* end;
+    CharT overflow = {}; // Written to instead once the buffer is full
+
+    CharT& operator*() { return out != end ? *out : overflow; }
+    TruncatingIterator& operator++() {
+        if (out != end) {
+            out++;
+        }
+        return *this;
+    }
+    TruncatingIterator operator++(int) {
+        auto previous = *this;
+        ++*this;
+        return previous;
+    }
+};
+
+class LogRing {
+private:
+    std::unique_ptr<LogRecord[]> records = std::make_unique<LogRecord[]>(LOG_RING_CAPACITY);
+    std::atomic<uint64_t> pushPosition = 0;
+    uint64_t flushPosition = 0; // Only touched by the flushing thread
+    std::atomic<uint64_t> numDropped = 0;
+    uint64_t numDroppedReported = 0;
+
+public:
+    LogRing() {
+        for (size_t i = 0; i < LOG_RING_CAPACITY; i++) {
+            records[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Claims the next free slot, or returns null if the ring is full. The slot must be passed to Publish() afterwards.
+    LogRecord* Claim() {
+        uint64_t position = pushPosition.load(std::memory_order_relaxed);
+        while (true) {
+            LogRecord& record = records[position % LOG_RING_CAPACITY];
+            uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return &record;
+                }
+            }
+            else if (sequence < position) {
+                numDropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr; // Still holds an unflushed record from the last lap
+            }
+            else {
+                position = pushPosition.load(std::memory_order_relaxed); // Another thread got there first
+            }
+        }
+    }
+
+    void Publish(LogRecord& record) {
+        record.sequence.store(record.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t Flush(size_t maxRecords, const std::function<void(std::string_view)>& write) {
+        uint64_t dropped = numDropped.load(std::memory_order_relaxed);
+        if (dropped != numDroppedReported) {
+            char note[64];
+            auto result = std::format_to_n(note, sizeof(note), "({} log records dropped, the log queue was full)", dropped - numDroppedReported);
+            write(std::string_view(note, result.out - note));
+            numDroppedReported = dropped;
+        }
+
+        size_t numWritten = 0;
+        while (numWritten < maxRecords) {
+            LogRecord& record = records[flushPosition % LOG_RING_CAPACITY];
+            if (record.sequence.load(std::memory_order_acquire) != flushPosition + 1) {
+                break; // Empty, or the next record is still being written
+            }
+            write(std::string_view(record.text, record.length));
+            record.sequence.store(flushPosition + LOG_RING_CAPACITY, std::memory_order_release);
+            flushPosition++;
+            numWritten++;
+        }
+        return numWritten;
+    }
+
+    uint64_t GetNumDropped() const {
+        return numDropped.load(std::memory_order_relaxed);
+    }
+};
+
+static LogRing logRing;
+
+// A slot claimed from the ring, published when this goes out of scope however the writer leaves, since a slot left
+// unpublished would stop the flusher there for good, and the ring would fill up behind it.
+class ClaimedLogRecord {
+private:
+    LogRecord* record = logRing.Claim();
+
+public:
+    ClaimedLogRecord() {
+        if (record) {
+            record->length = 0;
+        }
+    }
+
+    ClaimedLogRecord(const ClaimedLogRecord&) = delete;
+    ClaimedLogRecord& operator=(const ClaimedLogRecord&) = delete;
+
+    ~ClaimedLogRecord() {
+        if (record) {
+            logRing.Publish(*record);
+        }
+    }
+
+    explicit operator bool() const { return record != nullptr; }
+    LogRecord* operator->() const { return record; }
+    LogRecord& operator*() const { return *record; }
+};
+
+static void MarkTruncated(LogRecord& record) {
+    static const std::string_view ELLIPSIS = "...";
+    if (record.length == LOG_RECORD_MAX_LENGTH) {
+        std::copy(ELLIPSIS.begin(), ELLIPSIS.end(), record.text + LOG_RECORD_MAX_LENGTH - ELLIPSIS.size());
+    }
+}
+
+void PushLogRecord(std::string_view format, std::format_args args) {
+    ClaimedLogRecord record;
+    if (!record) {
+        return;
+    }
+
+    TruncatingIterator<char> out{ record->text, record->text + LOG_RECORD_MAX_LENGTH };
+    try {
+        out = std::vformat_to(out, format, args);
+    }
+    catch (const std::format_error&) {
+        out = std::format_to(TruncatingIterator<char>{ record->text, record->text + LOG_RECORD_MAX_LENGTH }, "Bad log format: {}", format);
+    }
+    catch (...) {
+        // e.g. a formatter for one of the arguments throwing, which shouldn't take down the caller for a log line
+        out = std::format_to(TruncatingIterator<char>{ record->text, record->text + LOG_RECORD_MAX_LENGTH }, "Log formatting failed: {}", format);
+    }
+    record->length = out.out - record->text;
+    MarkTruncated(*record);
+}
+
+// Encodes a UTF-16 (Windows) or UTF-32 code unit sequence as UTF-8 into out.
+static void EncodeUtf8(std::wstring_view text, TruncatingIterator<char>& out) {
+    for (size_t i = 0; i < text.size(); i++) {
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && i + 1 < text.size()) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<uint32_t>(text[++i]) - 0xDC00);
+        }
+
+        if (c < 0x80) {
+            *out++ = static_cast<char>(c);
+        }
+        else if (c < 0x800) {
+            *out++ = static_cast<char>(0xC0 | (c >> 6));
+            *out++ = static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000) {
+            *out++ = static_cast<char>(0xE0 | (c >> 12));
+            *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else {
+            *out++ = static_cast<char>(0xF0 | (c >> 18));
+            *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+void PushLogRecord(std::wstring_view format, std::wformat_args args) {
+    // Format on the stack first, since the ring only holds UTF-8
+    std::array<wchar_t, LOG_RECORD_MAX_LENGTH> wideText;
+    std::wstring_view formatted;
+    try {
+        auto result = std::vformat_to(TruncatingIterator<wchar_t>{ wideText.data(), wideText.data() + wideText.size() }, format, args);
+        formatted = std::wstring_view(wideText.data(), result.out - wideText.data());
+    }
+    catch (...) {
+        formatted = format;
+    }
+
+    ClaimedLogRecord record;
+    if (!record) {
+        return;
+    }
+    TruncatingIterator<char> out{ record->text, record->text + LOG_RECORD_MAX_LENGTH };
+    EncodeUtf8(formatted, out);
+    record->length = out.out - record->text;
+    MarkTruncated(*record);
+}
+
+size_t FlushLogRecords(size_t maxRecords, const std::function<void(std::string_view)>& write) {
+    return logRing.Flush(maxRecords, write);
+}
+
+uint64_t GetNumDroppedLogRecords() {
+    return logRing.GetNumDropped();
+}
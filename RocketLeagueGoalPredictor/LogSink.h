@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <string_view>
+
+// Asynchronous sink behind LOG(), so logging never blocks the thread doing it on the BakkesMod console. Records are
+// formatted straight into a slot of a fixed size lock-free ring, and a single consumer (the game thread) later passes
+// them on to the console at a bounded rate. When the ring is full, new records are dropped and counted rather than
+// waiting for space. Records longer than LOG_RECORD_MAX_LENGTH are truncated.
+
+const size_t LOG_RECORD_MAX_LENGTH = 384;
+
+// Any thread may push.
+void PushLogRecord(std::string_view format, std::format_args args);
+void PushLogRecord(std::wstring_view format, std::wformat_args args);
+
+// Passes up to maxRecords of the oldest records to write, in the order they were pushed, plus a note of how many were
+// dropped since the last flush. Only one thread at a time may flush. Returns the number of records written.
+size_t FlushLogRecords(size_t maxRecords, const std::function<void(std::string_view)>& write);
+
+// Total records dropped because the ring was full.
+uint64_t GetNumDroppedLogRecords();
+
+// Queued rather than logged straight away, so it's safe and cheap to call from any thread.
+template <typename... Args>
+void LOG(std::string_view format_str, Args&&... args) {
+    PushLogRecord(format_str, std::make_format_args(args...));
+}
+
+template <typename... Args>
+void LOG(std::wstring_view format_str, Args&&... args) {
+    PushLogRecord(format_str, std::make_wformat_args(args...));
+}
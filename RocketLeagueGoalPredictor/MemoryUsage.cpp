@@ -0,0 +1,40 @@
+#include "MemoryUsage.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fstream>
+#include <limits>
+#endif
+
+std::optional<ProcessMemoryUsage> GetProcessMemoryUsage() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return std::nullopt;
+    }
+    return ProcessMemoryUsage{ counters.WorkingSetSize, counters.PeakWorkingSetSize };
+#else
+    std::ifstream status("/proc/self/status");
+    if (!status) {
+        return std::nullopt;
+    }
+
+    ProcessMemoryUsage usage;
+    std::string key;
+    size_t valueKb;
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> valueKb) {
+            usage.residentBytes = valueKb * 1024;
+        }
+        else if (key == "VmHWM:" && status >> valueKb) {
+            usage.peakResidentBytes = valueKb * 1024;
+        }
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return usage;
+#endif
+}
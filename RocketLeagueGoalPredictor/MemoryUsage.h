@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Approximate per-element bookkeeping of the standard containers (tree links / list links), for memory accounting
+const size_t MAP_NODE_OVERHEAD_BYTES = 32;
+const size_t HASH_NODE_OVERHEAD_BYTES = 16;
+
+struct ProcessMemoryUsage {
+    size_t residentBytes = 0;
+    size_t peakResidentBytes = 0;
+};
+
+// Resident memory of the whole process (working set on Windows), which includes the game itself. Returns nullopt if
+// the OS wouldn't say.
+std::optional<ProcessMemoryUsage> GetProcessMemoryUsage();
+
+// Highest value seen so far for each of a set of named memory consumers, which are sampled by calling Update().
+class MemoryPeaks {
+private:
+    std::map<std::string, size_t, std::less<>> peakBytes;
+
+public:
+    // Returns the peak including this sample.
+    size_t Update(std::string_view name, size_t bytes) {
+        auto it = peakBytes.find(name);
+        if (it == peakBytes.end()) {
+            it = peakBytes.emplace(name, bytes).first;
+        }
+        it->second = std::max(it->second, bytes);
+        return it->second;
+    }
+
+    size_t Get(std::string_view name) const {
+        auto it = peakBytes.find(name);
+        return it == peakBytes.end() ? 0 : it->second;
+    }
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+// Unbounded lock-free multi-producer single-consumer queue (Vyukov style linked list). Any thread may Push(),
+// but only one thread at a time may TryPop().
+template <typename T>
+class MpscQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        std::optional<T> value;
+    };
+
+    std::atomic<Node*> head; // Most recently pushed node, producers swap themselves in here
+    Node* tail; // Stub node whose next is the oldest unconsumed value, only touched by the consumer
+
+public:
+    MpscQueue() {
+        Node* stub = new Node();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        while (TryPop()) {}
+        delete tail;
+    }
+
+    void Push(T value) {
+        Node* node = new Node();
+        node->value.emplace(std::move(value));
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> TryPop() {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return std::nullopt;
+        }
+
+        std::optional<T> value = std::move(next->value);
+        next->value.reset(); // next becomes the new stub
+        delete tail;
+        tail = next;
+        return value;
+    }
+};
@@ -0,0 +1,168 @@
+#include "OrtProfileSummary.h"
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+static const std::string_view KERNEL_TIME_SUFFIX = "_kernel_time";
+
+// Finds the end of the JSON string starting at the opening quote at start, returning the index of its closing quote.
+static size_t FindStringEnd(std::string_view json, size_t start) {
+    for (size_t i = start + 1; i < json.size(); i++) {
+        if (json[i] == '\\') {
+            i++;
+        }
+        else if (json[i] == '"') {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Splits the top level array of the trace into its event objects. Event objects may contain nested objects (args).
+static std::vector<std::string_view> SplitEvents(std::string_view json) {
+    std::vector<std::string_view> events;
+    int depth = 0;
+    size_t eventStart = 0;
+    for (size_t i = 0; i < json.size(); i++) {
+        char c = json[i];
+        if (c == '"') {
+            i = FindStringEnd(json, i);
+            if (i == std::string_view::npos) {
+                break;
+            }
+        }
+        else if (c == '{') {
+            if (depth++ == 0) {
+                eventStart = i;
+            }
+        }
+        else if (c == '}' && depth > 0) {
+            if (--depth == 0) {
+                events.push_back(json.substr(eventStart, i + 1 - eventStart));
+            }
+        }
+    }
+    return events;
+}
+
+// Raw value text of the first "key" : value pair in the object, without quotes for strings. ORT's traces are flat
+// apart from args, and none of the keys we look for are repeated inside it, so there's no need for a real parser.
+static std::string_view FindValue(std::string_view object, std::string_view key) {
+    std::string quotedKey = std::format("\"{}\"", key);
+    size_t pos = 0;
+    while ((pos = object.find(quotedKey, pos)) != std::string_view::npos) {
+        size_t i = pos + quotedKey.size();
+        while (i < object.size() && (object[i] == ' ' || object[i] == '\t' || object[i] == '\n' || object[i] == '\r')) {
+            i++;
+        }
+        if (i >= object.size() || object[i] != ':') {
+            pos = i; // Matched a value rather than a key
+            continue;
+        }
+        i++;
+        while (i < object.size() && (object[i] == ' ' || object[i] == '\t' || object[i] == '\n' || object[i] == '\r')) {
+            i++;
+        }
+        if (i < object.size() && object[i] == '"') {
+            size_t end = FindStringEnd(object, i);
+            return end == std::string_view::npos ? std::string_view() : object.substr(i + 1, end - i - 1);
+        }
+        size_t end = object.find_first_of(",}", i);
+        return object.substr(i, end == std::string_view::npos ? std::string_view::npos : end - i);
+    }
+    return {};
+}
+
+static double ParseNumber(std::string_view text) {
+    double value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+std::optional<OrtProfileSummary> SummarizeOrtProfile(const std::filesystem::path& profilePath) {
+    std::ifstream file(profilePath, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string json = contents.str();
+
+    OrtProfileSummary summary;
+    std::unordered_map<std::string_view, OperatorProfile> operatorsByNode;
+    for (auto event : SplitEvents(json)) {
+        auto category = FindValue(event, "cat");
+        auto name = FindValue(event, "name");
+        double durationUs = ParseNumber(FindValue(event, "dur"));
+
+        if (category == "Session" && name == "model_run") {
+            summary.numRuns++;
+            summary.totalRunUs += durationUs;
+        }
+        else if (category == "Node" && name.ends_with(KERNEL_TIME_SUFFIX)) {
+            auto nodeName = name.substr(0, name.size() - KERNEL_TIME_SUFFIX.size());
+            auto& op = operatorsByNode[nodeName];
+            if (op.numCalls == 0) {
+                op.nodeName = nodeName;
+                op.opType = FindValue(event, "op_name");
+            }
+            op.numCalls++;
+            op.totalUs += durationUs;
+            op.maxUs = std::max(op.maxUs, durationUs);
+            summary.totalKernelUs += durationUs;
+        }
+    }
+
+    for (auto& [nodeName, op] : operatorsByNode) {
+        summary.operators.push_back(std::move(op));
+    }
+    std::sort(summary.operators.begin(), summary.operators.end(), [](const auto& a, const auto& b) {
+        return a.totalUs > b.totalUs;
+    });
+    return summary;
+}
+
+std::vector<std::string> FormatOrtProfileSummary(const OrtProfileSummary& summary, size_t maxRows) {
+    std::vector<std::string> lines;
+    double totalKernelUs = std::max(summary.totalKernelUs, 1e-9);
+    int numRuns = std::max(summary.numRuns, 1);
+
+    lines.push_back(std::format("{} runs, {:.1f} us per run, of which {:.1f} us in {} nodes",
+        summary.numRuns, summary.totalRunUs / numRuns, summary.totalKernelUs / numRuns, summary.operators.size()));
+
+    lines.push_back(std::format("{:>4}  {:<40} {:<20} {:>7} {:>12} {:>10} {:>10} {:>6}",
+        "#", "node", "op", "calls", "total ms", "avg us", "max us", "%"));
+    for (size_t i = 0; i < std::min(maxRows, summary.operators.size()); i++) {
+        const auto& op = summary.operators[i];
+        lines.push_back(std::format("{:>4}  {:<40} {:<20} {:>7} {:>12.3f} {:>10.1f} {:>10.1f} {:>6.1f}",
+            i + 1, op.nodeName, op.opType, op.numCalls, op.totalUs / 1000, op.totalUs / std::max(op.numCalls, 1),
+            op.maxUs, 100 * op.totalUs / totalKernelUs));
+    }
+    if (summary.operators.size() > maxRows) {
+        lines.push_back(std::format("      ... {} more nodes", summary.operators.size() - maxRows));
+    }
+
+    // Many small nodes of one type can matter more than any single one of them
+    std::map<std::string, std::pair<int, double>> byOpType;
+    for (const auto& op : summary.operators) {
+        auto& [numNodes, totalUs] = byOpType[op.opType];
+        numNodes++;
+        totalUs += op.totalUs;
+    }
+    std::vector<std::pair<std::string, std::pair<int, double>>> opTypes(byOpType.begin(), byOpType.end());
+    std::sort(opTypes.begin(), opTypes.end(), [](const auto& a, const auto& b) {
+        return a.second.second > b.second.second;
+    });
+
+    lines.push_back(std::format("{:<20} {:>7} {:>12} {:>6}", "op", "nodes", "total ms", "%"));
+    for (const auto& [opType, stats] : opTypes) {
+        lines.push_back(std::format("{:<20} {:>7} {:>12.3f} {:>6.1f}",
+            opType, stats.first, stats.second / 1000, 100 * stats.second / totalKernelUs));
+    }
+    return lines;
+}
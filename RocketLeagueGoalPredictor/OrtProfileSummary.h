@@ -0,0 +1,28 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Kernel time for one node of the model, over all the profiled runs.
+struct OperatorProfile {
+    std::string nodeName;
+    std::string opType;
+    int numCalls = 0;
+    double totalUs = 0;
+    double maxUs = 0;
+};
+
+// Per-node timings from an ONNX Runtime profile, with the nodes sorted by total time, most expensive first.
+struct OrtProfileSummary {
+    int numRuns = 0;
+    double totalRunUs = 0; // Whole session->Run() calls, including overhead outside the kernels
+    double totalKernelUs = 0;
+    std::vector<OperatorProfile> operators;
+};
+
+// Reads the JSON trace ONNX Runtime writes from Session::EndProfiling(). Returns nullopt if it can't be read.
+std::optional<OrtProfileSummary> SummarizeOrtProfile(const std::filesystem::path& profilePath);
+
+// Human readable table of the top maxRows nodes plus totals by op type, one line per entry.
+std::vector<std::string> FormatOrtProfileSummary(const OrtProfileSummary& summary, size_t maxRows);
@@ -0,0 +1,129 @@
+#pragma once
+#include "GameEvents.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+// Point in time copy of PerformanceStats, for display.
+struct PerformanceSnapshot {
+    int numLatencies = 0;
+    double latencyP50Ms = 0;
+    double latencyP95Ms = 0;
+    double latencyP99Ms = 0;
+    int queueDepth = 0;
+    double predictionsPerSecond = 0;
+    uint64_t numDropped = 0;
+    uint64_t numSkipped = 0;
+    std::optional<Augmentation> lastAugmentation;
+    size_t trackerMemoryBytes = 0;
+    double drawTimeMs = 0;
+};
+
+// Live pipeline counters for the diagnostics strip. Written by the game thread (predictions) and the render thread
+// (draw time), and read by the render thread, so everything is behind one mutex; all updates are O(1), and the
+// percentiles are only computed when taking a snapshot.
+class PerformanceStats {
+private:
+    static constexpr size_t NUM_RECENT_LATENCIES = 256;
+    static constexpr double RATE_WINDOW_MS = 1000;
+    static constexpr double DRAW_TIME_SMOOTHING = 0.05;
+
+    mutable std::mutex mutex;
+
+    std::array<double, NUM_RECENT_LATENCIES> recentLatenciesMs;
+    size_t numLatencies = 0;
+    size_t nextLatencyIndex = 0;
+
+    double rateWindowStartMs = 0;
+    int numInRateWindow = 0;
+    double predictionsPerSecond = 0;
+
+    int queueDepth = 0;
+    uint64_t numDropped = 0;
+    uint64_t numSkipped = 0;
+    std::optional<Augmentation> lastAugmentation;
+    size_t trackerMemoryBytes = 0;
+    double drawTimeMs = 0;
+
+    static double Percentile(std::array<double, NUM_RECENT_LATENCIES>& values, size_t count, double fraction) {
+        auto nth = values.begin() + static_cast<size_t>(fraction * (count - 1));
+        std::nth_element(values.begin(), nth, values.begin() + count);
+        return *nth;
+    }
+
+public:
+    // A prediction finished (or failed / was cancelled, if empty).
+    void OnPredictionCompleted(const std::optional<Prediction>& prediction, double currentEpochTimeMs) {
+        std::lock_guard lock(mutex);
+        if (!prediction) {
+            numDropped++;
+            return;
+        }
+
+        recentLatenciesMs[nextLatencyIndex] = prediction->prediction_time_ms;
+        nextLatencyIndex = (nextLatencyIndex + 1) % NUM_RECENT_LATENCIES;
+        numLatencies = std::min(numLatencies + 1, NUM_RECENT_LATENCIES);
+        lastAugmentation = prediction->augmentation;
+
+        if (currentEpochTimeMs - rateWindowStartMs >= RATE_WINDOW_MS) {
+            predictionsPerSecond = rateWindowStartMs > 0 ? numInRateWindow * 1000 / (currentEpochTimeMs - rateWindowStartMs) : 0;
+            rateWindowStartMs = currentEpochTimeMs;
+            numInRateWindow = 0;
+        }
+        numInRateWindow++;
+    }
+
+    // Pending predictions were thrown away without finishing, e.g. on a game change.
+    void OnPredictionsDropped(size_t count) {
+        std::lock_guard lock(mutex);
+        numDropped += count;
+    }
+
+    // A prediction was due but not scheduled because the inference lanes were all backed up.
+    void OnPredictionSkipped() {
+        std::lock_guard lock(mutex);
+        numSkipped++;
+    }
+
+    void SetQueueDepth(int depth) {
+        std::lock_guard lock(mutex);
+        queueDepth = depth;
+    }
+
+    void SetTrackerMemoryBytes(size_t bytes) {
+        std::lock_guard lock(mutex);
+        trackerMemoryBytes = bytes;
+    }
+
+    void OnFrameDrawn(double frameDrawTimeMs) {
+        std::lock_guard lock(mutex);
+        drawTimeMs = drawTimeMs == 0 ? frameDrawTimeMs : drawTimeMs + DRAW_TIME_SMOOTHING * (frameDrawTimeMs - drawTimeMs);
+    }
+
+    PerformanceSnapshot GetSnapshot() const {
+        std::array<double, NUM_RECENT_LATENCIES> latencies;
+        PerformanceSnapshot snapshot;
+        {
+            std::lock_guard lock(mutex);
+            std::copy_n(recentLatenciesMs.begin(), numLatencies, latencies.begin());
+            snapshot.numLatencies = static_cast<int>(numLatencies);
+            snapshot.queueDepth = queueDepth;
+            snapshot.predictionsPerSecond = predictionsPerSecond;
+            snapshot.numDropped = numDropped;
+            snapshot.numSkipped = numSkipped;
+            snapshot.lastAugmentation = lastAugmentation;
+            snapshot.trackerMemoryBytes = trackerMemoryBytes;
+            snapshot.drawTimeMs = drawTimeMs;
+        }
+
+        if (snapshot.numLatencies > 0) {
+            snapshot.latencyP50Ms = Percentile(latencies, snapshot.numLatencies, 0.50);
+            snapshot.latencyP95Ms = Percentile(latencies, snapshot.numLatencies, 0.95);
+            snapshot.latencyP99Ms = Percentile(latencies, snapshot.numLatencies, 0.99);
+        }
+        return snapshot;
+    }
+};
@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "PlayerRegistry.h"
+#include "utils.h"
+#include <algorithm>
+
+inline static int first_slot_index(unsigned char team) {
+    return team == 0 ? 0 : 3;
+}
+
+PlayerId PlayerRegistry::Intern(const std::string& uniqueId) {
+    auto [it, inserted] = idsByUniqueId.try_emplace(uniqueId, static_cast<PlayerId>(idsByUniqueId.size()));
+    return it->second;
+}
+
+void PlayerRegistry::Refresh(ServerWrapper server) {
+    scratchPriKeys.clear();
+
+    auto PRIs = server.GetPRIs();
+    for (int i = 0; i < PRIs.Count(); ++i) {
+        PriWrapper pri = PRIs.Get(i);
+        if (pri.IsNull() || pri.IsSpectator() || pri.GetTeamNum() > 1) {
+            continue;
+        }
+        scratchPriKeys.push_back({ pri.memory_address, pri.GetTeamNum() });
+    }
+
+    if (scratchPriKeys != priKeys) {
+        std::swap(priKeys, scratchPriKeys);
+        Reassign(server);
+    }
+}
+
+void PlayerRegistry::Reassign(ServerWrapper server) {
+    // Vacate slots whose PRI left, or switched teams.
+    for (int i = 0; i < 6; i++) {
+        auto& slot = slots[i];
+        PriKey key = { slot.priAddress, static_cast<unsigned char>(i < 3 ? 0 : 1) };
+        if (slot.priAddress != 0 && std::find(priKeys.begin(), priKeys.end(), key) == priKeys.end()) {
+            slot.priAddress = 0;
+        }
+    }
+
+    // Place any new PRIs, only now paying for their id strings.
+    auto PRIs = server.GetPRIs();
+    for (int i = 0; i < PRIs.Count(); ++i) {
+        PriWrapper pri = PRIs.Get(i);
+        if (pri.IsNull() || pri.IsSpectator() || pri.GetTeamNum() > 1 || GetSlot(pri.memory_address).has_value()) {
+            continue;
+        }
+
+        auto team = pri.GetTeamNum();
+        auto begin = slots.begin() + first_slot_index(team);
+        auto end = begin + 3;
+
+        auto id = Intern(GetId(pri));
+        // Duplicate ids can happen e.g. for bots, so give those their own handle rather than sharing a slot's identity.
+        if (std::any_of(slots.begin(), slots.end(), [&](const Slot& s) { return s.priAddress != 0 && s.id == id; })) {
+            id = Intern(GetId(pri) + "#" + std::to_string(pri.memory_address));
+        }
+
+        // Prefer this player's previous slot, then a never-used slot, then any vacant slot.
+        auto slot = std::find_if(begin, end, [&](const Slot& s) { return s.priAddress == 0 && s.id == id; });
+        if (slot == end) {
+            slot = std::find_if(begin, end, [](const Slot& s) { return s.priAddress == 0 && !s.id.has_value(); });
+        }
+        if (slot == end) {
+            slot = std::find_if(begin, end, [](const Slot& s) { return s.priAddress == 0; });
+        }
+        if (slot == end) {
+            continue; // More than 3 players on this team, so not a 3v3 we can predict anyway
+        }
+
+        slot->priAddress = pri.memory_address;
+        slot->id = id;
+    }
+}
+
+std::optional<int> PlayerRegistry::GetSlot(uintptr_t priAddress) const {
+    if (priAddress == 0) {
+        return std::nullopt;
+    }
+
+    for (int i = 0; i < 6; i++) {
+        if (slots[i].priAddress == priAddress) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<PlayerId> PlayerRegistry::GetPlayerId(int slot) const {
+    if (slots[slot].priAddress == 0) {
+        return std::nullopt;
+    }
+    return slots[slot].id;
+}
+
+void PlayerRegistry::Clear() {
+    idsByUniqueId.clear();
+    priKeys.clear();
+    slots = {};
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "GameEvents.h"
+#include <array>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Interns each player's unique id string into a small PlayerId handle for the current match, and gives each player
+// a stable input slot for the model (0-2 blue, 3-5 orange). Everything is only recomputed when the set of PRIs changes,
+// so we don't build id strings every frame and players don't shuffle between slots.
+class PlayerRegistry {
+private:
+    struct PriKey {
+        uintptr_t address;
+        unsigned char team;
+
+        auto operator<=>(const PriKey&) const = default;
+    };
+
+    struct Slot {
+        uintptr_t priAddress = 0; // 0 when vacant
+        std::optional<PlayerId> id; // Kept after vacating so a reconnecting player gets their old slot back
+    };
+
+    std::unordered_map<std::string, PlayerId> idsByUniqueId;
+    std::vector<PriKey> priKeys; // As of the last Refresh()
+    std::vector<PriKey> scratchPriKeys;
+    std::array<Slot, 6> slots;
+
+    PlayerId Intern(const std::string& uniqueId);
+    void Reassign(ServerWrapper server);
+
+public:
+    // Cheap check of the server's current PRIs, only reassigning slots if they changed since the last call.
+    void Refresh(ServerWrapper server);
+
+    std::optional<int> GetSlot(uintptr_t priAddress) const;
+    std::optional<PlayerId> GetPlayerId(int slot) const;
+
+    void Clear();
+};
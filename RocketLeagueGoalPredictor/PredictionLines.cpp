@@ -0,0 +1,33 @@
+#include "PredictionLines.h"
+
+void DrawPredictionLines(ImDrawList* dl, const PredictionLinePoints& points, double maxGapMs, ImU32 blueColor, ImU32 orangeColor) {
+    int numPoints = static_cast<int>(points.timesMs.size());
+    auto isGap = [&](int i) {
+        return i == numPoints || points.timesMs[i] - points.timesMs[i - 1] >= maxGapMs;
+    };
+
+    int runStart = 0;
+    for (int i = 1; i <= numPoints; i++) {
+        if (!isGap(i)) {
+            continue;
+        }
+        if (i - runStart >= 2) {
+            dl->AddPolyline(&points.blue[runStart], i - runStart, blueColor, false, 1.0f);
+            dl->AddPolyline(&points.orange[runStart], i - runStart, orangeColor, false, 1.0f);
+        }
+        runStart = i;
+    }
+
+    runStart = 0;
+    for (int i = 1; i <= numPoints; i++) {
+        bool gap = isGap(i);
+        bool colorChange = !gap && i - 1 > runStart && points.deltaColors[i] != points.deltaColors[i - 1];
+        if (!gap && !colorChange) {
+            continue;
+        }
+        if (i - runStart >= 2) {
+            dl->AddPolyline(&points.delta[runStart], i - runStart, points.deltaColors[runStart + 1], false, 4.0f);
+        }
+        runStart = gap ? i : i - 1;
+    }
+}
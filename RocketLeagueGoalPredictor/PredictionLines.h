@@ -0,0 +1,25 @@
+#pragma once
+#include "IMGUI/imgui.h"
+#include <vector>
+
+// Screen space points for the graph's prediction lines, reused across frames to avoid reallocating.
+struct PredictionLinePoints {
+    std::vector<ImVec2> blue;
+    std::vector<ImVec2> orange;
+    std::vector<ImVec2> delta;
+    std::vector<ImU32> deltaColors; // Colour of the delta line leading into each point
+    std::vector<double> timesMs;
+
+    void Clear() {
+        blue.clear();
+        orange.clear();
+        delta.clear();
+        deltaColors.clear();
+        timesMs.clear();
+    }
+};
+
+// Draws each continuous run as a single polyline, splitting where points are at least maxGapMs apart. The delta line
+// goes on top, and is also split where its colour changes, with consecutive runs sharing their boundary point so the
+// line stays connected. Only needs ImGui, so cli/bench can time it without the BakkesMod SDK.
+void DrawPredictionLines(ImDrawList* dl, const PredictionLinePoints& points, double maxGapMs, ImU32 blueColor, ImU32 orangeColor);
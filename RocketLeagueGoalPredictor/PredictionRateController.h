@@ -0,0 +1,134 @@
+#pragma once
+#include "GameEvents.h"
+#include <algorithm>
+#include <atomic>
+
+// Fastest prediction rate of just over 30 FPS, since replays are limited to 30 FPS anyway.
+const double MIN_PREDICTION_INTERVAL_MS = 30;
+// Slowest rate we'll throttle down to, which still keeps the graph reasonably smooth.
+const double MAX_PREDICTION_INTERVAL_MS = 200;
+
+// Adapts the prediction rate to how well the game is keeping up with a target frame rate. Frame times are smoothed,
+// and every adjustment period the interval backs off multiplicatively if the game is too slow, or recovers linearly if
+// there's headroom, with a dead band in between so it doesn't oscillate around the target.
+// The interval is a real time budget, which is converted to game time using the measured playback speed, so replay
+// fast-forward costs the same per second as normal playback, and slow-motion spends the leftover budget on augmentation.
+// Updated from the game thread, but the current state can be read from any thread.
+class PredictionRateController {
+private:
+    static constexpr double FRAME_TIME_SMOOTHING = 0.1; // Weight of the newest frame in the moving average
+    static constexpr double ADJUSTMENT_PERIOD_MS = 500;
+    static constexpr double SLOW_FRAME_RATIO = 1.1; // Throttle when smoothed frames are this much slower than target
+    static constexpr double FAST_FRAME_RATIO = 0.9; // Recover when smoothed frames are this much faster than target
+    static constexpr double BACKOFF_FACTOR = 1.5;
+    static constexpr double RECOVERY_STEP_MS = 10;
+    // Ignore frames longer than this, e.g. alt-tabbing or loading, rather than letting them swing the average
+    static constexpr double MAX_FRAME_TIME_MS = 250;
+    static constexpr double PLAYBACK_SPEED_SMOOTHING = 0.2;
+    // Game time jumps bigger than this between samples are seeks rather than playback
+    static constexpr double MAX_PLAYBACK_GAME_STEP_MS = 1000;
+    // Longer real time between game time changes is a pause rather than playback. Separate from MAX_FRAME_TIME_MS
+    // since in slow-motion each 30 FPS replay step takes far longer than a frame, e.g. ~670ms at MIN_PLAYBACK_SPEED.
+    static constexpr double MAX_PLAYBACK_REAL_STEP_MS = 1000;
+    static constexpr double MIN_PLAYBACK_SPEED = 0.05;
+    static constexpr double MAX_PLAYBACK_SPEED = 20;
+
+    double targetFrameTimeMs = 1000.0 / 60;
+    double smoothedFrameTimeMs = 0;
+    double msSinceAdjustment = 0;
+    std::atomic<double> intervalMs = MIN_PREDICTION_INTERVAL_MS;
+    std::atomic<double> averageFps = 0;
+    std::atomic<double> playbackSpeed = 1; // Game time per real time
+
+public:
+    void SetTargetFps(int targetFps) {
+        targetFrameTimeMs = 1000.0 / std::max(targetFps, 1);
+    }
+
+    // Called once per rendered frame with the real (not game) time since the last frame.
+    void OnFrame(double frameTimeMs) {
+        if (frameTimeMs <= 0 || frameTimeMs > MAX_FRAME_TIME_MS) {
+            return;
+        }
+
+        smoothedFrameTimeMs = smoothedFrameTimeMs == 0
+            ? frameTimeMs
+            : smoothedFrameTimeMs + FRAME_TIME_SMOOTHING * (frameTimeMs - smoothedFrameTimeMs);
+        averageFps = 1000 / smoothedFrameTimeMs;
+
+        msSinceAdjustment += frameTimeMs;
+        if (msSinceAdjustment < ADJUSTMENT_PERIOD_MS) {
+            return;
+        }
+        msSinceAdjustment = 0;
+
+        if (smoothedFrameTimeMs > targetFrameTimeMs * SLOW_FRAME_RATIO) {
+            intervalMs = std::min(intervalMs * BACKOFF_FACTOR, MAX_PREDICTION_INTERVAL_MS);
+        }
+        else if (smoothedFrameTimeMs < targetFrameTimeMs * FAST_FRAME_RATIO) {
+            intervalMs = std::max(intervalMs - RECOVERY_STEP_MS, MIN_PREDICTION_INTERVAL_MS);
+        }
+    }
+
+    // Called whenever the game time changes, with how much it and real time have advanced since it last changed.
+    // Game time in replays only advances in 30 FPS steps, so sampling per change rather than per frame avoids aliasing.
+    void OnGameTimeAdvanced(double gameTimeDeltaMs, double realTimeDeltaMs) {
+        // Skip pauses, seeks and rewinds, which say nothing about the playback speed
+        if (gameTimeDeltaMs <= 0 || gameTimeDeltaMs > MAX_PLAYBACK_GAME_STEP_MS ||
+            realTimeDeltaMs <= 0 || realTimeDeltaMs > MAX_PLAYBACK_REAL_STEP_MS) {
+            return;
+        }
+
+        double speed = std::clamp(gameTimeDeltaMs / realTimeDeltaMs, MIN_PLAYBACK_SPEED, MAX_PLAYBACK_SPEED);
+        playbackSpeed = playbackSpeed + PLAYBACK_SPEED_SMOOTHING * (speed - playbackSpeed);
+    }
+
+    // Minimum real time between predictions.
+    double GetIntervalMs() const {
+        return intervalMs;
+    }
+
+    // Minimum game time between predictions, which is never finer than the replay frame rate.
+    double GetGameIntervalMs() const {
+        return std::max(intervalMs * playbackSpeed, MIN_PREDICTION_INTERVAL_MS);
+    }
+
+    // Predictions per real second.
+    double GetRateHz() const {
+        return 1000 * playbackSpeed / GetGameIntervalMs();
+    }
+
+    double GetPlaybackSpeed() const {
+        return playbackSpeed;
+    }
+
+    // Raises the augmentation above the preferred setting when slow playback leaves spare budget, i.e. as long as it
+    // costs no more per second than the preferred augmentation would at the full real time rate.
+    Augmentation GetAugmentation(Augmentation preferred) const {
+        // Small allowance since the smoothed playback speed never settles exactly on e.g. 0.25x
+        double budget = (double)preferred * (1000 / intervalMs) / GetRateHz() + 0.05;
+        if (budget >= (int)AUGMENT_4X) {
+            return AUGMENT_4X;
+        }
+        if (budget >= (int)AUGMENT_2X) {
+            return std::max(preferred, AUGMENT_2X);
+        }
+        return preferred;
+    }
+
+    double GetAverageFps() const {
+        return averageFps;
+    }
+
+    bool IsThrottled() const {
+        return intervalMs > MIN_PREDICTION_INTERVAL_MS;
+    }
+
+    void Reset() {
+        smoothedFrameTimeMs = 0;
+        msSinceAdjustment = 0;
+        intervalMs = MIN_PREDICTION_INTERVAL_MS;
+        averageFps = 0;
+        playbackSpeed = 1;
+    }
+};
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "bakkesmod/wrappers/GuiManagerWrapper.h"
+#include "AllocationCounter.h"
 #include "GoalPredictor.h"
+#include "PredictionLines.h"
+#include "Tracer.h"
 #include "utils.h"
 
 inline static std::string to_utf8(ImWchar c) {
@@ -39,6 +42,8 @@ const std::string GOAL_EMOJI_UTF8 = to_utf8(GOAL_EMOJI_CHAR);
 
 const double MAX_PREDICTION_LINE_TIME_GAP_MS = 100;
 const double MAX_TOOLTIP_MOUSE_DIST_MS = 100;
+const float MIN_SECOND_LINE_SPACING = 40;
+const int DIAGNOSTICS_NUM_LINES = 3;
 
 const int GAUGE_WIDTH = 48;
 const int GAUGE_PADDING = 6;
@@ -126,6 +131,50 @@ void GoalPredictor::LoadRenderer() {
 	}
 }
 
+// Grid lines and their labels only depend on the graph's position, size and font, so are rebuilt only when they change.
+struct GridCache {
+	static constexpr int gridLines[] = { 5, 10, 25, 50, 75 };
+	static constexpr int numRows = std::size(gridLines) * 2 - 1;
+
+	struct Row {
+		float y;
+		char label[8];
+		ImVec2 labelSize;
+		bool bold;
+	};
+
+	ImVec2 pMin = ImVec2(-1, -1);
+	ImVec2 pMax = ImVec2(-1, -1);
+	ImFont* font = nullptr;
+	float fontSize = 0;
+	std::array<Row, numRows> rows;
+
+	void Update(const GraphContext& ctx) {
+		ImFont* currentFont = ImGui::GetFont();
+		float currentFontSize = ImGui::GetFontSize();
+		if (ctx.pMin.x == pMin.x && ctx.pMin.y == pMin.y && ctx.pMax.x == pMax.x && ctx.pMax.y == pMax.y &&
+			currentFont == font && currentFontSize == fontSize) {
+			return;
+		}
+		pMin = ctx.pMin;
+		pMax = ctx.pMax;
+		font = currentFont;
+		fontSize = currentFontSize;
+
+		int numLines = std::size(gridLines);
+		for (int i = -numLines + 1; i < numLines; i++) {
+			int gridLine = i == 0 ? 0 : gridLines[abs(i)];
+			int gridLineSigned = gridLine * (i < 0 ? -1 : 1);
+
+			auto& row = rows[i + numLines - 1];
+			row.y = ctx.ToScreenYScaled(gridLineSigned / 100.0f);
+			*std::format_to_n(row.label, sizeof(row.label) - 1, "{}%", gridLine).out = '\0';
+			row.labelSize = ImGui::CalcTextSize(row.label);
+			row.bold = i == 0;
+		}
+	}
+};
+
 static void DrawGrid(ImDrawList* dl, const GraphContext& ctx) {
 	// Background
 	float midY = ctx.pMin.y + ctx.size.y / 2;
@@ -134,43 +183,55 @@ static void DrawGrid(ImDrawList* dl, const GraphContext& ctx) {
 	dl->AddRect(ctx.pMin, ctx.pMax, COL_BORDER);
 
 	// Horizontal percentage grid lines
-	static const int gridLines[] = { 5, 10, 25, 50, 75 };
-	static int numLines = std::size(gridLines);
-	for (int i = -numLines + 1; i < numLines; i++) {
-		int gridLine = i == 0 ? 0 : gridLines[abs(i)];
-		int gridLineSigned = gridLine * (i < 0 ? -1 : 1);
-
-		float y_screen = ctx.ToScreenYScaled(gridLineSigned / 100.0f);
-		auto percent_str = std::format("{}%", gridLine);
+	static GridCache gridCache;
+	gridCache.Update(ctx);
+	for (const auto& row : gridCache.rows) {
+		ImU32 color = row.bold ? COL_GRID_BOLD : COL_GRID;
+		float thickness = row.bold ? 2.0f : 1.0f;
 
-		ImU32 color = i == 0 ? COL_GRID_BOLD : COL_GRID;
-		float thickness = i == 0 ? 2.0f : 1.0f;
-
-		dl->AddLine(ImVec2(ctx.pMin.x, y_screen), ImVec2(ctx.pMax.x, y_screen), color, thickness);
-
-		ImVec2 textSize = ImGui::CalcTextSize(percent_str.c_str());
-		dl->AddText(ImVec2(ctx.pMin.x + 3, y_screen - textSize.y - 1), COL_TEXT, percent_str.c_str());
+		dl->AddLine(ImVec2(ctx.pMin.x, row.y), ImVec2(ctx.pMax.x, row.y), color, thickness);
+		dl->AddText(ImVec2(ctx.pMin.x + 3, row.y - row.labelSize.y - 1), COL_TEXT, row.label);
 	}
 }
 
 static void DrawEventLines(ImDrawList* dl, const GraphContext& ctx, const GameDataTracker& gameDataTracker) {
-	auto secondEvents = gameDataTracker.GetRangeInclusive<SecondEvent>(ctx.tMin, ctx.tMax);
-	for (auto const& [timeMs, secondEvent] : secondEvents) {
+	// Only label every Nth second when zoomed out, so the labels don't overlap
+	static const int secondSteps[] = { 1, 5, 15, 30, 60 };
+	double pixelsPerSecond = 1000 * ctx.size.x / (ctx.tMax - ctx.tMin);
+	int secondStep = secondSteps[std::size(secondSteps) - 1];
+	for (int step : secondSteps) {
+		if (step * pixelsPerSecond >= MIN_SECOND_LINE_SPACING) {
+			secondStep = step;
+			break;
+		}
+	}
+
+	// The clock never runs faster than time passes, so after a labelled second, skip ahead to just before the next one
+	gameDataTracker.ForEachSkipping<SecondEvent>(ctx.tMin, ctx.tMax, [&](double timeMs, const SecondEvent& secondEvent) {
+		if (secondEvent.second % secondStep != 0) {
+			return timeMs;
+		}
+
 		float x = ctx.ToScreenX(timeMs);
 		dl->AddLine(ImVec2(x, ctx.pMin.y), ImVec2(x, ctx.pMax.y), COL_GRID, 1.0f);
 
+		// Formatted on the stack since this runs for every visible second on every frame
 		int minutes = secondEvent.second / 60;
 		int seconds = secondEvent.second % 60;
-		auto time_str = std::format("{}:{:02}", minutes, seconds);
-		ImVec2 textSize = ImGui::CalcTextSize(time_str.c_str());
-		dl->AddText(ImVec2(x + 4, ctx.pMax.y - textSize.y - 2), COL_TEXT, time_str.c_str());
-	}
-
-	auto ballHitEvents = gameDataTracker.GetRangeInclusive<BallHitEvent>(ctx.tMin, ctx.tMax);
-	for (auto const& [timeMs, ballHitEvent] : ballHitEvents) {
+		char time_str[16];
+		*std::format_to_n(time_str, sizeof(time_str) - 1, "{}:{:02}", minutes, seconds).out = '\0';
+		ImVec2 textSize = ImGui::CalcTextSize(time_str);
+		dl->AddText(ImVec2(x + 4, ctx.pMax.y - textSize.y - 2), COL_TEXT, time_str);
+		return timeMs + (secondStep - 0.5) * 1000;
+	});
+
+	// At most one ball hit line per pixel column, skipping the rest of its column
+	double msPerPixel = (ctx.tMax - ctx.tMin) / ctx.size.x;
+	gameDataTracker.ForEachSkipping<BallHitEvent>(ctx.tMin, ctx.tMax, [&](double timeMs, const BallHitEvent& ballHitEvent) {
 		float x = ctx.ToScreenX(timeMs);
 		dl->AddLine(ImVec2(x, ctx.pMin.y), ImVec2(x, ctx.pMax.y), GetTeamColor(ballHitEvent.orange), 1.0f);
-	}
+		return ctx.tMin + (std::floor((timeMs - ctx.tMin) / msPerPixel) + 1) * msPerPixel;
+	});
 
 	// Dashed line for demos
 	auto demolitionEvents = gameDataTracker.GetRangeInclusive<DemolitionEvent>(ctx.tMin, ctx.tMax);
@@ -196,38 +257,49 @@ static void DrawEventLines(ImDrawList* dl, const GraphContext& ctx, const GameDa
 }
 
 static void DrawPredictions(ImDrawList* dl, const GraphContext& ctx, const GameDataTracker& gameDataTracker) {
-	auto predictions = gameDataTracker.GetRangeInclusive<Prediction>(ctx.tMin, ctx.tMax);
-	auto prevIt = predictions.begin();
-	if (prevIt == predictions.end()) {
+	static PredictionLinePoints points;
+	points.Clear();
+
+	// Once there'd be several predictions per pixel, draw summaries from the pyramid instead, so the cost depends on
+	// the graph width rather than how much history is shown.
+	double msPerPixel = (ctx.tMax - ctx.tMin) / ctx.size.x;
+	if (msPerPixel >= PYRAMID_BASE_BUCKET_MS) {
+		double bucketWidthMs = 0;
+		gameDataTracker.ForEachSummary<Prediction>(ctx.tMin, ctx.tMax, msPerPixel,
+			[&](double startMs, double widthMs, const Prediction::Summary& summary) {
+				bucketWidthMs = widthMs;
+				ImU32 deltaColor = summary.MostlyReliable() ? COL_WHITE : COL_YELLOW;
+
+				// Shade the delta's range within the bucket behind its mean
+				dl->AddRectFilled(
+					ImVec2(ctx.ToScreenX(startMs), ctx.ToScreenYScaled(summary.max_delta)),
+					ImVec2(ctx.ToScreenX(startMs + widthMs), ctx.ToScreenYScaled(summary.min_delta)),
+					with_alpha(deltaColor, 64));
+
+				float x = ctx.ToScreenX(startMs + widthMs / 2);
+				points.blue.emplace_back(x, ctx.ToScreenYScaled(summary.MeanBlue()));
+				points.orange.emplace_back(x, ctx.ToScreenYScaled(-summary.MeanOrange()));
+				points.delta.emplace_back(x, ctx.ToScreenYScaled(summary.MeanDelta()));
+				points.deltaColors.push_back(deltaColor);
+				points.timesMs.push_back(startMs);
+			});
+
+		// Only adjacent buckets are connected
+		DrawPredictionLines(dl, points, bucketWidthMs * 1.5, COL_BLUE, COL_ORANGE);
 		return;
 	}
 
-	for (auto nextIt = std::next(prevIt); nextIt != predictions.end(); ++prevIt, ++nextIt) {
-		auto& [t1, p1] = *prevIt;
-		auto& [t2, p2] = *nextIt;
-
-		if (t2 - t1 >= MAX_PREDICTION_LINE_TIME_GAP_MS) {
-			continue;
-		}
-
-		float x1 = ctx.ToScreenX(t1);
-		float x2 = ctx.ToScreenX(t2);
-
-		dl->AddLine(
-			ImVec2(x1, ctx.ToScreenYScaled(p1.prob_blue)),
-			ImVec2(x2, ctx.ToScreenYScaled(p2.prob_blue)),
-			COL_BLUE, 1.0f);
-
-		dl->AddLine(
-			ImVec2(x1, ctx.ToScreenYScaled(-p1.prob_orange)),
-			ImVec2(x2, ctx.ToScreenYScaled(-p2.prob_orange)),
-			COL_ORANGE, 1.0f);
-
-		dl->AddLine(
-			ImVec2(x1, ctx.ToScreenYScaled(p1.prob_delta)),
-			ImVec2(x2, ctx.ToScreenYScaled(p2.prob_delta)),
-			p2.reliability == RELIABLE ? COL_WHITE : COL_YELLOW, 4.0f);
+	// Transform every visible prediction to screen space once, rather than per line segment
+	for (auto const& [timeMs, prediction] : gameDataTracker.GetRangeInclusive<Prediction>(ctx.tMin, ctx.tMax)) {
+		float x = ctx.ToScreenX(timeMs);
+		points.blue.emplace_back(x, ctx.ToScreenYScaled(prediction.prob_blue));
+		points.orange.emplace_back(x, ctx.ToScreenYScaled(-prediction.prob_orange));
+		points.delta.emplace_back(x, ctx.ToScreenYScaled(prediction.prob_delta));
+		points.deltaColors.push_back(prediction.reliability == RELIABLE ? COL_WHITE : COL_YELLOW);
+		points.timesMs.push_back(timeMs);
 	}
+
+	DrawPredictionLines(dl, points, MAX_PREDICTION_LINE_TIME_GAP_MS, COL_BLUE, COL_ORANGE);
 }
 
 static void DrawTooltip(Prediction prediction) {
@@ -323,10 +395,11 @@ static void DrawGauge(ImDrawList* dl, const GraphContext& ctx, const GameDataTra
 	dl->AddLine(ImVec2(ctx.pMin.x, y_delta), ImVec2(ctx.pMax.x, y_delta), prediction.reliability == RELIABLE ? COL_WHITE : COL_YELLOW, 4.0f);
 
 	int pct = static_cast<int>(round(std::abs(delta) * 100));
-	auto percent_str = std::format("{}%", pct);
+	char percent_str[8];
+	*std::format_to_n(percent_str, sizeof(percent_str) - 1, "{}%", pct).out = '\0';
 
 	// Center text X, Position Y slightly above/below line to not cover it
-	ImVec2 text_size = ImGui::CalcTextSize(percent_str.c_str());
+	ImVec2 text_size = ImGui::CalcTextSize(percent_str);
 	float text_x = ctx.pMin.x + (ctx.size.x - text_size.x) / 2;
 	float text_y = y_delta - text_size.y - 2;
 
@@ -335,15 +408,15 @@ static void DrawGauge(ImDrawList* dl, const GraphContext& ctx, const GameDataTra
 		text_y = y_delta + 4;
 	}
 
-	dl->AddText(ImVec2(text_x + 1, text_y + 1), COL_BLACK, percent_str.c_str()); // Shadow
-	dl->AddText(ImVec2(text_x, text_y), COL_WHITE, percent_str.c_str());
+	dl->AddText(ImVec2(text_x + 1, text_y + 1), COL_BLACK, percent_str); // Shadow
+	dl->AddText(ImVec2(text_x, text_y), COL_WHITE, percent_str);
 
 	if (ImGui::IsMouseHoveringRect(ctx.pMin, ctx.pMax)) {
 		DrawTooltip(prediction);
 	}
 }
 
-static inline void DrawEmoji(ImDrawList* dl, const GraphContext& ctx, double timeMs, bool orange, std::string emoji) {
+static inline void DrawEmoji(ImDrawList* dl, const GraphContext& ctx, double timeMs, bool orange, const std::string& emoji) {
 	dl->AddText(ImVec2(ctx.ToScreenX(timeMs) - EMOJI_FONT_SIZE / 2, ctx.pMin.y - 2 + EMOJI_ORANGE_OFFSET * orange), GetTeamColor(orange), emoji.c_str());
 }
 
@@ -381,6 +454,13 @@ void GoalPredictor::RenderWindow() {
 		return;
 	}
 
+	SetTraceThreadName("Render");
+	ScopedTrace trace("RenderWindow");
+
+	// The overlay runs at full FPS, so it should not allocate in steady state.
+	auto allocationCountBefore = GetThreadAllocationCount();
+	auto drawStartTime = std::chrono::steady_clock::now();
+
 	auto displaySize = ImGui::GetIO().DisplaySize;
 	ImGui::SetNextWindowPos(ImVec2(displaySize.x / 20.0f, displaySize.y / 20.0f), ImGuiCond_FirstUseEver);
 	ImGui::SetNextWindowSize(ImVec2(displaySize.x / 2.5f, displaySize.y / 2.5f), ImGuiCond_FirstUseEver);
@@ -401,6 +481,9 @@ void GoalPredictor::RenderWindow() {
 			LOG("Installed emoji font");
 		}
 	}
+	fontAtlasWidth = ImGui::GetIO().Fonts->TexWidth;
+	fontAtlasHeight = ImGui::GetIO().Fonts->TexHeight;
+	emojiFontNumGlyphs = emojiFont ? emojiFont->Glyphs.Size : 0;
 
 	auto contentRegion = ImGui::GetContentRegionAvail();
 	ImVec2 cursorPos = ImGui::GetCursorScreenPos();
@@ -409,7 +492,8 @@ void GoalPredictor::RenderWindow() {
 	double tMin = tMax - *graphHistoryMs;
 
 	const float graphWidth = contentRegion.x - (GAUGE_WIDTH + GAUGE_PADDING);
-	const float sharedHeight = contentRegion.y - EMOJI_ZONE_HEIGHT;
+	const float diagnosticsHeight = *showDiagnostics ? DIAGNOSTICS_NUM_LINES * ImGui::GetTextLineHeightWithSpacing() : 0.0f;
+	const float sharedHeight = contentRegion.y - EMOJI_ZONE_HEIGHT - diagnosticsHeight;
 
 	// --- Draw Main Graph ---
 	{
@@ -472,7 +556,44 @@ void GoalPredictor::RenderWindow() {
 		drawList->PopClipRect();
 	}
 
+	// --- Draw Diagnostics Strip ---
+	if (*showDiagnostics) {
+		RenderDiagnostics();
+	}
+
 	ImGui::End();
+
+	auto drawDuration = std::chrono::steady_clock::now() - drawStartTime;
+	GetPipelineHistograms()[STAGE_OVERLAY_DRAW].Record(drawDuration);
+	performanceStats.OnFrameDrawn(std::chrono::duration<double, std::milli>(drawDuration).count());
+	LogRenderAllocations(GetThreadAllocationCount() - allocationCountBefore);
+}
+
+// Live pipeline stats for diagnosing stutter, DIAGNOSTICS_NUM_LINES lines of text.
+void GoalPredictor::RenderDiagnostics() {
+	auto stats = performanceStats.GetSnapshot();
+
+	ImGui::TextColored(ImColor(COL_TEXT),
+		"Latency p50 %.1f / p95 %.1f / p99 %.1f ms (last %d)  |  %.1f predictions/s  |  Queue %d  |  Dropped %llu  Skipped %llu",
+		stats.latencyP50Ms, stats.latencyP95Ms, stats.latencyP99Ms, stats.numLatencies, stats.predictionsPerSecond,
+		stats.queueDepth, (unsigned long long)stats.numDropped, (unsigned long long)stats.numSkipped);
+	ImGui::TextColored(ImColor(COL_TEXT),
+		"Augmentation %dx  |  %s x%d  |  Tracker %.1f KB  |  Draw %.2f ms",
+		stats.lastAugmentation ? (int)stats.lastAugmentation.value() : 0, inferenceEngine.GetBackendName().c_str(),
+		inferencePool.GetNumLanes(), stats.trackerMemoryBytes / 1024.0, stats.drawTimeMs);
+
+	uint64_t hooksTotalNs = 0, hooksMaxNs = 0;
+	const HookCost* slowestHook = nullptr;
+	for (const auto& hook : hookCosts.GetAll()) {
+		hooksTotalNs += hook->totalNs;
+		if (!slowestHook || hook->maxNs > hooksMaxNs) {
+			hooksMaxNs = hook->maxNs;
+			slowestHook = hook.get();
+		}
+	}
+	ImGui::TextColored(ImColor(COL_TEXT),
+		"Hooks %.2f ms/s on the game thread  |  Max %.0f us (%s)",
+		hooksTotalNs / 1e6 / hookCosts.GetSecondsSinceReset(), hooksMaxNs / 1e3, slowestHook ? slowestHook->name.c_str() : "-");
 }
 
 void GoalPredictor::RenderSettings() {
@@ -512,9 +633,10 @@ void GoalPredictor::RenderSettings() {
 
 	ImGui::NewLine();
 
-	int _graphHistoryMs = *graphHistoryMs;
-	if (ImGui::SliderInt("Graph History (milliseconds)", &_graphHistoryMs, MIN_GRAPH_HISTORY, MAX_GRAPH_HISTORY)) {
-		graphHistoryMsCvar->setValue(_graphHistoryMs);
+	// In seconds on a power curve, so short histories are still easy to pick while the whole match is available
+	float _graphHistorySec = *graphHistoryMs / 1000.0f;
+	if (ImGui::SliderFloat("Graph History (seconds)", &_graphHistorySec, MIN_GRAPH_HISTORY / 1000.0f, MAX_GRAPH_HISTORY / 1000.0f, "%.1f", 3.0f)) {
+		graphHistoryMsCvar->setValue(static_cast<int>(_graphHistorySec * 1000));
 	}
 	ImGui::SameLine();
 	if (ImGui::Button("Reset to default##graphHistory")) {
@@ -550,6 +672,34 @@ void GoalPredictor::RenderSettings() {
 
 	ImGui::NewLine();
 
+	ImGui::Text("Prediction Rate: %.1f per second (game at %.0f FPS, playback at %.2fx)",
+		predictionRateController.GetRateHz(), predictionRateController.GetAverageFps(), predictionRateController.GetPlaybackSpeed());
+	if (predictionRateController.IsThrottled()) {
+		ImGui::SameLine();
+		ImGui::TextColored(COL_YELLOW_VEC4, "[THROTTLED]");
+	}
+	int _targetFps = *targetFps;
+	if (ImGui::SliderInt("Target FPS", &_targetFps, MIN_TARGET_FPS, MAX_TARGET_FPS)) {
+		targetFpsCvar->setValue(_targetFps);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Reset to default##targetfps")) {
+		targetFpsCvar->setValue(DEFAULT_TARGET_FPS);
+	}
+	ImGui::TextWrapped("Predictions are automatically made less often while the game is running below the target FPS, and return to full rate when there's headroom.");
+	ImGui::TextWrapped("If your frame rate is capped below the target, e.g. at 30 FPS, lower the target to match, otherwise predictions will stay throttled.");
+	ImGui::TextWrapped("When watching replays in slow motion, spare time is used for extra augmentation, and when fast-forwarding, predictions are spaced further apart so the cost stays the same.");
+
+	ImGui::NewLine();
+
+	bool _showDiagnostics = *showDiagnostics;
+	if (ImGui::Checkbox("Show Performance Diagnostics", &_showDiagnostics)) {
+		showDiagnosticsCvar->setValue(_showDiagnostics);
+	}
+	ImGui::TextWrapped("Shows prediction latency, throughput and overlay draw time below the graph, which helps when reporting stutter.");
+
+	ImGui::NewLine();
+
 	ImGui::Separator();
 
 	ImGui::SetWindowFontScale(1.25f);
@@ -0,0 +1,111 @@
+#pragma once
+#include "GameDataTracker.h"
+#include "GameEvents.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+
+const double BIG_BOOST_RESPAWN_PERIOD_MS = 10 * 1000;
+const double PLAYER_RESPAWN_PERIOD_MS = 3 * 1000;
+const double EVENT_LOOKUP_GRACE_MS = 100;
+// If the game time moves backwards or jumps forward by more than this between syncs (e.g. seeking around a replay)
+// we can't trust the incremental state anymore, so rebuild it from the GameDataTracker.
+const double RESPAWN_TIMERS_MAX_SYNC_STEP_MS = 1000;
+
+// Tracks the most recent big boost pickup and demolition for each of the 6 boost / player slots so the model's
+// respawn timer inputs can be read in O(1) on every prediction, rather than re-scanning the GameDataTracker.
+// The event hooks push updates as they happen, and Sync() falls back to a full rebuild when playback jumps.
+class RespawnTimers {
+private:
+    static constexpr double NEVER_MS = -std::numeric_limits<double>::infinity();
+
+    std::array<double, 6> boostPickupTimesMs;
+    std::array<double, 6> demolitionTimesMs;
+    double lastSyncTimeMs = NEVER_MS;
+
+    static std::optional<double> GetKickoffTimeMs(const GameDataTracker& gameDataTracker, double currentTimeMs) {
+        auto latestGoalTimeMs = gameDataTracker.GetMostRecentTimeMs<GoalEvent>(currentTimeMs);
+        auto latestCountdownTimeMs = gameDataTracker.GetMostRecentTimeMs<KickoffEvent>(currentTimeMs);
+
+        if (!latestGoalTimeMs && !latestCountdownTimeMs) {
+            return std::nullopt;
+        }
+        else {
+            return std::max(latestGoalTimeMs.value_or(-1), latestCountdownTimeMs.value_or(-1));
+        }
+    }
+
+    static std::optional<float> GetRespawnTimerSec(double eventTimeMs, double currentTimeMs, double respawnPeriodMs) {
+        if (eventTimeMs > currentTimeMs || eventTimeMs < currentTimeMs - (respawnPeriodMs + EVENT_LOOKUP_GRACE_MS)) {
+            return std::nullopt;
+        }
+
+        auto respawnTimeMs = eventTimeMs + respawnPeriodMs;
+        auto timeToRespawnMs = std::min(currentTimeMs - respawnTimeMs, 0.0);
+        return static_cast<float>(timeToRespawnMs / 1000);
+    }
+
+    void Rebuild(const GameDataTracker& gameDataTracker, double currentTimeMs) {
+        boostPickupTimesMs.fill(NEVER_MS);
+        demolitionTimesMs.fill(NEVER_MS);
+
+        // Respawn timers reset on kickoff, so ignore anything before the most recent one.
+        auto kickoffTimeMs = GetKickoffTimeMs(gameDataTracker, currentTimeMs).value_or(NEVER_MS);
+
+        // Ranges are in ascending time order, so the most recent event per slot wins.
+        auto boostPickupMinTimeMs = std::max(currentTimeMs - (BIG_BOOST_RESPAWN_PERIOD_MS + EVENT_LOOKUP_GRACE_MS), kickoffTimeMs);
+        for (auto const& [timeMs, boostPickup] : gameDataTracker.GetRangeInclusive<BigBoostPickupEvent>(boostPickupMinTimeMs, currentTimeMs)) {
+            boostPickupTimesMs[boostPickup.boost_index] = timeMs;
+        }
+
+        auto demolitionMinTimeMs = std::max(currentTimeMs - (PLAYER_RESPAWN_PERIOD_MS + EVENT_LOOKUP_GRACE_MS), kickoffTimeMs);
+        for (auto const& [timeMs, demolition] : gameDataTracker.GetRangeInclusive<DemolitionEvent>(demolitionMinTimeMs, currentTimeMs)) {
+            demolitionTimesMs[demolition.victim_index] = timeMs;
+        }
+    }
+
+public:
+    RespawnTimers() {
+        Clear();
+    }
+
+    void OnBigBoostPickup(double timeMs, int boostIndex) {
+        boostPickupTimesMs[boostIndex] = timeMs;
+    }
+
+    void OnDemolition(double timeMs, int playerIndex) {
+        demolitionTimesMs[playerIndex] = timeMs;
+    }
+
+    // Goals and kickoff countdowns both reset every respawn timer.
+    void OnKickoff() {
+        boostPickupTimesMs.fill(NEVER_MS);
+        demolitionTimesMs.fill(NEVER_MS);
+    }
+
+    // Call before reading timers at a new game time. Cheap unless the time jumped, in which case we rebuild.
+    void Sync(const GameDataTracker& gameDataTracker, double currentTimeMs) {
+        if (currentTimeMs < lastSyncTimeMs || currentTimeMs - lastSyncTimeMs > RESPAWN_TIMERS_MAX_SYNC_STEP_MS) {
+            Rebuild(gameDataTracker, currentTimeMs);
+        }
+        lastSyncTimeMs = currentTimeMs;
+    }
+
+    // Seconds until the big boost respawns (<= 0), or NaN if the boost is live (or we didn't see it get picked up).
+    float GetBoostRespawnTimerSec(int boostIndex, double currentTimeMs) const {
+        return GetRespawnTimerSec(boostPickupTimesMs[boostIndex], currentTimeMs, BIG_BOOST_RESPAWN_PERIOD_MS)
+            .value_or(std::numeric_limits<float>::quiet_NaN());
+    }
+
+    // Seconds until the demolished player respawns (<= 0), if we saw the demolition.
+    std::optional<float> GetPlayerRespawnTimerSec(int playerIndex, double currentTimeMs) const {
+        return GetRespawnTimerSec(demolitionTimesMs[playerIndex], currentTimeMs, PLAYER_RESPAWN_PERIOD_MS);
+    }
+
+    void Clear() {
+        boostPickupTimesMs.fill(NEVER_MS);
+        demolitionTimesMs.fill(NEVER_MS);
+        lastSyncTimeMs = NEVER_MS;
+    }
+};
@@ -0,0 +1,65 @@
+#include "RotationMath.h"
+#include <algorithm>
+
+const size_t ROTATOR_CHUNK_SIZE = 64;
+
+// Minimax polynomials for sin and cos on [-pi/4, pi/4] (from Cephes sinf / cosf)
+const float SIN_C1 = -1.6666654611e-1f;
+const float SIN_C2 = 8.3321608736e-3f;
+const float SIN_C3 = -1.9515295891e-4f;
+const float COS_C1 = 4.166664568298827e-2f;
+const float COS_C2 = -1.388731625493765e-3f;
+const float COS_C3 = 2.443315711809948e-5f;
+
+// Range reduction is exact since rotators are integers: take the nearest quarter turn (16384 units) as the quadrant,
+// leaving a remainder within +/- an eighth of a turn for the polynomials. Branchless so loops over it vectorize.
+inline static void SinCosRotatorUnits(int32_t units, float& sinOut, float& cosOut) {
+    int32_t u = units & 0xFFFF;
+    int32_t quarterTurns = (u + 8192) >> 14; // 0-4
+    float x = static_cast<float>(u - (quarterTurns << 14)) * UNR_ROT_TO_RAD;
+    int32_t quadrant = quarterTurns & 3;
+
+    float x2 = x * x;
+    float s = x + x * x2 * (SIN_C1 + x2 * (SIN_C2 + x2 * SIN_C3));
+    float c = 1.0f - 0.5f * x2 + x2 * x2 * (COS_C1 + x2 * (COS_C2 + x2 * COS_C3));
+
+    // sin(x + q * pi/2) and cos(x + q * pi/2) for quadrants 0-3: (s, c), (c, -s), (-s, -c), (-c, s)
+    bool swap = (quadrant & 1) != 0;
+    float sinAbs = swap ? c : s;
+    float cosAbs = swap ? s : c;
+    sinOut = (quadrant & 2) != 0 ? -sinAbs : sinAbs;
+    cosOut = ((quadrant + 1) & 2) != 0 ? -cosAbs : cosAbs;
+}
+
+void RotatorsToRotAndUpVectors(const Rotator3i* rotators, size_t count, Vec3f* rots, Vec3f* ups) {
+    alignas(32) float SinPitch[ROTATOR_CHUNK_SIZE], CosPitch[ROTATOR_CHUNK_SIZE];
+    alignas(32) float SinYaw[ROTATOR_CHUNK_SIZE], CosYaw[ROTATOR_CHUNK_SIZE];
+    alignas(32) float SinRoll[ROTATOR_CHUNK_SIZE], CosRoll[ROTATOR_CHUNK_SIZE];
+
+    for (size_t start = 0; start < count; start += ROTATOR_CHUNK_SIZE) {
+        size_t n = std::min(ROTATOR_CHUNK_SIZE, count - start);
+        const Rotator3i* R = rotators + start;
+        Vec3f* rot = rots + start;
+        Vec3f* up = ups + start;
+
+        for (size_t i = 0; i < n; ++i) {
+            SinCosRotatorUnits(R[i].pitch, SinPitch[i], CosPitch[i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            SinCosRotatorUnits(R[i].yaw, SinYaw[i], CosYaw[i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            SinCosRotatorUnits(R[i].roll, SinRoll[i], CosRoll[i]);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            rot[i].x = CosPitch[i] * CosYaw[i];
+            rot[i].y = CosPitch[i] * SinYaw[i];
+            rot[i].z = SinPitch[i];
+
+            up[i].x = -CosYaw[i] * SinPitch[i] * CosRoll[i] - SinYaw[i] * SinRoll[i];
+            up[i].y = -SinYaw[i] * SinPitch[i] * CosRoll[i] + CosYaw[i] * SinRoll[i];
+            up[i].z = CosPitch[i] * CosRoll[i];
+        }
+    }
+}
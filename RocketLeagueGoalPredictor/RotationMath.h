@@ -0,0 +1,42 @@
+#pragma once
+#include "GameSnapshot.h"
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <utility>
+
+const float UNR_ROT_TO_RAD = static_cast<float>(std::numbers::pi / 32768);
+
+// Converts a rotator to its forward ("rot") and up unit vectors. Scalar reference for the batched version below.
+inline std::pair<Vec3f, Vec3f> RotatorToRotAndUpVectors(const Rotator3i& R) {
+    float fPitch = R.pitch * UNR_ROT_TO_RAD;
+    float fYaw = R.yaw * UNR_ROT_TO_RAD;
+    float fRoll = R.roll * UNR_ROT_TO_RAD;
+
+    float SinPitch = sinf(fPitch);
+    float CosPitch = cosf(fPitch);
+    float SinYaw = sinf(fYaw);
+    float CosYaw = cosf(fYaw);
+    float SinRoll = sinf(fRoll);
+    float CosRoll = cosf(fRoll);
+
+    Vec3f rot = {
+        CosPitch * CosYaw,
+        CosPitch * SinYaw,
+        SinPitch,
+    };
+
+    Vec3f up = {
+        -CosYaw * SinPitch * CosRoll - SinYaw * SinRoll,
+        -SinYaw * SinPitch * CosRoll + CosYaw * SinRoll,
+        CosPitch * CosRoll,
+    };
+
+    return { rot, up };
+}
+
+// Batched RotatorToRotAndUpVectors, used by BuildFeatures for all 6 cars of a snapshot at once.
+// Uses a polynomial sincos on the rotators' integer units, laid out as flat loops so the compiler vectorizes them.
+// Within 2.3e-7 per component of the exact result, and within 5.1e-7 of the scalar version for rotators in the game's
+// range (checked by cli/tests/RotationMathTest.cpp). Further out the scalar version's own error grows with the angle.
+void RotatorsToRotAndUpVectors(const Rotator3i* rotators, size_t count, Vec3f* rots, Vec3f* ups);
@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "SnapshotCapture.h"
+#include "logging.h"
+
+inline static Vec3f ToVec3f(const Vector& v) {
+    return { v.X, v.Y, v.Z };
+}
+
+inline static RigidBodySnapshot ToRigidBodySnapshot(const RBState& state) {
+    return { ToVec3f(state.Location), ToVec3f(state.LinearVelocity), ToVec3f(state.AngularVelocity) };
+}
+
+std::optional<GameSnapshot> CaptureSnapshot(ServerWrapper server, const PlayerRegistry& playerRegistry, double currentTimeMs) {
+    if (!server || server.IsNull() || !server.GetbRoundActive()) {
+        return std::nullopt;
+    }
+
+    auto ball = server.GetBall();
+    // GetExplosionTime() only set during PostGoalScored time (not to be confused with post-goal ReplayPlayback)
+    if (ball.IsNull() || ball.GetExplosionTime() > 0) {
+        return std::nullopt;
+    }
+
+    GameSnapshot snapshot = {};
+    snapshot.timeMs = currentTimeMs;
+    snapshot.ball = ToRigidBodySnapshot(ball.GetCurrentRBState());
+    snapshot.secondsRemaining = server.GetSecondsRemaining();
+    snapshot.overtime = static_cast<bool>(server.GetbOverTime());
+
+    int num_team0_found = 0;
+    int num_team1_found = 0;
+    auto PRIs = server.GetPRIs();
+    for (int i = 0; i < PRIs.Count(); ++i) {
+        PriWrapper pri = PRIs.Get(i);
+        if (pri.IsNull() || pri.IsSpectator() || pri.GetTeamNum() > 1) {
+            continue;
+        }
+
+        // Slots are kept stable across frames by the registry, rather than following PRI order
+        auto slot = playerRegistry.GetSlot(pri.memory_address);
+        if (!slot.has_value()) {
+            continue;
+        }
+        int p_index = slot.value();
+        if (p_index < 3) {
+            num_team0_found += 1;
+        }
+        else {
+            num_team1_found += 1;
+        }
+
+        auto& carSnapshot = snapshot.cars[p_index];
+        auto car = pri.GetCar();
+        // Demolished. Former case can occur when seeking forward in a replay, but usually it's latter case
+        carSnapshot.demolished = car.IsNull() || car.GetbHidden();
+        if (carSnapshot.demolished) {
+            continue;
+        }
+
+        auto rotation = car.GetRotation();
+        auto boostComponent = car.GetBoostComponent();
+        carSnapshot.rigidBody = ToRigidBodySnapshot(car.GetCurrentRBState());
+        carSnapshot.rotation = { rotation.Pitch, rotation.Yaw, rotation.Roll };
+        carSnapshot.boostFraction = !boostComponent.IsNull() ? boostComponent.GetPercentBoostFull() : 0.0f;
+    }
+
+    if (num_team0_found != 3 || num_team1_found != 3) {
+        return std::nullopt;
+    }
+
+    return snapshot;
+}
+
+static std::string getSubarrayString(const FeatureVector& data, size_t i, size_t L, int resolution = 3) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(resolution);
+
+    oss << "[";
+    for (size_t j = 0; j < L; ++j) {
+        oss << data[i + j];
+        if (j % 3 == 2 && j < L - 1) {
+            oss << " || ";
+        } else if (j < L - 1) {
+            oss << ", ";
+        }
+    }
+    oss << "]";
+
+    return oss.str();
+}
+
+void LogFeatures(ServerWrapper server, const PlayerRegistry& playerRegistry, const FeatureVector& features, double currentTimeMs) {
+    LOG("---- Model inputs at game time {}", currentTimeMs);
+    LOG("BALL: {}", getSubarrayString(features, 0, NUM_BALL_COLS));
+
+    auto PRIs = server.GetPRIs();
+    for (int p_index = 0; p_index < 6; ++p_index) {
+        std::string name = "?";
+        for (int i = 0; i < PRIs.Count(); ++i) {
+            PriWrapper pri = PRIs.Get(i);
+            if (!pri.IsNull() && playerRegistry.GetSlot(pri.memory_address) == p_index) {
+                name = pri.GetPlayerName().ToString();
+                break;
+            }
+        }
+        LOG("P{} ({}): {}", p_index, name, getSubarrayString(features, player_col_index(p_index, 0), NUM_PLAYER_COLS));
+    }
+
+    LOG("BOOSTS: {}", getSubarrayString(features, boost_index(0), 6));
+}
+
+std::optional<int> GetBigBoostIndex(Vector location) {
+    // Unlike the model inputs, we do *not* negate x-values here to make them match a normal x-y space
+    // we just leave them in pure game coordinates, and assume the location is as well.
+    static const Vector BIG_BOOST_LOCATIONS[6] = {
+        {  3072.0f, -4096.0f, 72.0f},
+        { -3072.0f, -4096.0f, 72.0f},
+        {  3584.0f,     0.0f, 72.0f},
+        { -3584.0f,     0.0f, 72.0f},
+        {  3072.0f,  4096.0f, 72.0f},
+        { -3072.0f,  4096.0f, 72.0f},
+    };
+    static const float EPSILON = 1.0f;
+
+    for (int i = 0; i < 6; i++) {
+        if ((BIG_BOOST_LOCATIONS[i] - location).magnitude() < EPSILON) {
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
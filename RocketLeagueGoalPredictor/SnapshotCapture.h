@@ -0,0 +1,13 @@
+#pragma once
+#include "FeatureBuilder.h"
+#include "GameSnapshot.h"
+#include "PlayerRegistry.h"
+#include <optional>
+
+// The game thread half of building model inputs: copies what we need out of the game objects, which the prediction
+// threads can't read from safely, into a GameSnapshot. Returns nullopt if the game isn't in a predictable state.
+std::optional<GameSnapshot> CaptureSnapshot(ServerWrapper server, const PlayerRegistry& playerRegistry, double currentTimeMs);
+
+void LogFeatures(ServerWrapper server, const PlayerRegistry& playerRegistry, const FeatureVector& features, double currentTimeMs);
+
+std::optional<int> GetBigBoostIndex(Vector location);
@@ -0,0 +1,76 @@
+#pragma once
+#include "FeatureBuilder.h"
+#include <cstdint>
+
+// Layout of the binary snapshot files written by SnapshotRecorder: a SnapshotFileHeader, then any number of records,
+// each a SnapshotRecordHeader followed by header.size bytes of payload. Files are only ever appended to, so one file
+// may hold several recording sessions of the same game (e.g. watching a replay twice), each starting with a
+// SNAPSHOT_SESSION record. Everything is little endian and packed; readers should skip record types they don't know.
+
+const char SNAPSHOT_MAGIC[8] = { 'G', 'P', 'S', 'N', 'A', 'P', '\r', '\n' };
+const uint32_t SNAPSHOT_VERSION = 1;
+const char SNAPSHOT_FILE_EXTENSION[] = ".gpsnap";
+
+enum SnapshotRecordType : uint8_t {
+    SNAPSHOT_SESSION = 1, // Start of a recording session, no payload
+    SNAPSHOT_INPUT = 2, // SnapshotInputRecord
+    SNAPSHOT_PREDICTION = 3, // SnapshotPredictionRecord
+    SNAPSHOT_SECOND = 4, // SnapshotSecondRecord
+    SNAPSHOT_BALL_HIT = 5, // SnapshotTeamRecord, the team that hit it
+    SNAPSHOT_DEMOLITION = 6, // SnapshotDemolitionRecord
+    SNAPSHOT_GOAL = 7, // SnapshotTeamRecord, the team that scored
+    SNAPSHOT_KICKOFF = 8, // No payload
+    SNAPSHOT_BIG_BOOST_PICKUP = 9, // SnapshotBigBoostPickupRecord
+};
+
+#pragma pack(push, 1)
+
+struct SnapshotFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t inputDim;
+};
+
+struct SnapshotRecordHeader {
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t size;
+    double gameTimeMs;
+};
+
+struct SnapshotInputRecord {
+    float inputs[INPUT_DIM]; // NaN where the value is unknown, as in the model input
+    uint32_t reliability; // PredictionReliability
+};
+
+struct SnapshotPredictionRecord {
+    float probBlue;
+    float probOrange;
+    uint32_t reliability; // PredictionReliability
+    uint32_t augmentation; // Augmentation
+    double predictionTimeMs;
+};
+
+struct SnapshotSecondRecord {
+    int32_t second;
+    uint8_t overtime;
+};
+
+struct SnapshotTeamRecord {
+    uint8_t orange; // else blue
+};
+
+struct SnapshotDemolitionRecord {
+    uint8_t victimOrange;
+    int32_t victimId; // PlayerId, only meaningful within one session
+    int32_t victimIndex;
+};
+
+struct SnapshotBigBoostPickupRecord {
+    int32_t boostIndex;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(SnapshotRecordHeader) == 16);
+static_assert(sizeof(SnapshotInputRecord) == INPUT_DIM * 4 + 4);
@@ -0,0 +1,196 @@
+#include "pch.h"
+#include "SnapshotRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// The writer polls rather than being woken, so recording never makes a syscall on the game thread
+static const auto WRITER_POLL_INTERVAL = std::chrono::milliseconds(50);
+
+SnapshotRecorder::~SnapshotRecorder() {
+    Stop();
+}
+
+void SnapshotRecorder::Start() {
+    if (writer.joinable()) {
+        return;
+    }
+    stopping = false;
+    writer = std::thread(&SnapshotRecorder::RunWriter, this);
+}
+
+void SnapshotRecorder::Stop() {
+    if (!writer.joinable()) {
+        return;
+    }
+    CloseFile();
+    stopping = true;
+    writer.join();
+}
+
+bool SnapshotRecorder::Push(uint8_t type, double gameTimeMs, const void* payload, uint32_t size) {
+    SnapshotRecordHeader header = { type, {}, size, gameTimeMs };
+    uint64_t totalSize = sizeof(header) + size;
+
+    uint64_t write = writePosition.load(std::memory_order_relaxed);
+    uint64_t read = readPosition.load(std::memory_order_acquire);
+    if (RING_CAPACITY - (write - read) < totalSize) {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto copyIn = [this](uint64_t position, const void* data, size_t dataSize) {
+        size_t offset = position % RING_CAPACITY;
+        size_t firstPart = std::min(dataSize, RING_CAPACITY - offset);
+        std::memcpy(ring.get() + offset, data, firstPart);
+        std::memcpy(ring.get(), static_cast<const char*>(data) + firstPart, dataSize - firstPart);
+    };
+    copyIn(write, &header, sizeof(header));
+    if (size > 0) {
+        copyIn(write + sizeof(header), payload, size);
+    }
+
+    writePosition.store(write + totalSize, std::memory_order_release);
+    return true;
+}
+
+void SnapshotRecorder::CopyOut(uint64_t position, void* out, size_t size) const {
+    size_t offset = position % RING_CAPACITY;
+    size_t firstPart = std::min(size, RING_CAPACITY - offset);
+    std::memcpy(out, ring.get() + offset, firstPart);
+    std::memcpy(static_cast<char*>(out) + firstPart, ring.get(), size - firstPart);
+}
+
+void SnapshotRecorder::RunWriter() {
+    std::ofstream file;
+    std::vector<char> payload;
+
+    while (true) {
+        // Checked before draining, so everything pushed before Stop() is written out
+        bool stop = stopping.load();
+
+        uint64_t read = readPosition.load(std::memory_order_relaxed);
+        uint64_t write = writePosition.load(std::memory_order_acquire);
+        while (read < write) {
+            SnapshotRecordHeader header;
+            CopyOut(read, &header, sizeof(header));
+            payload.resize(header.size);
+            if (header.size > 0) {
+                CopyOut(read + sizeof(header), payload.data(), header.size);
+            }
+
+            if (header.type == CONTROL_OPEN_FILE) {
+                file.close();
+                std::filesystem::path path = std::u8string(payload.begin(), payload.end());
+                std::error_code error;
+                std::filesystem::create_directories(path.parent_path(), error);
+                bool isNew = !std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) == 0;
+                file.open(path, std::ios::binary | std::ios::app);
+                if (!file) {
+                    LOG("Failed to open snapshot file {}", path.string());
+                }
+                else if (isNew) {
+                    SnapshotFileHeader fileHeader = {};
+                    std::memcpy(fileHeader.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+                    fileHeader.version = SNAPSHOT_VERSION;
+                    fileHeader.inputDim = INPUT_DIM;
+                    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+                    numBytesWritten += sizeof(fileHeader);
+                }
+            }
+            else if (header.type == CONTROL_CLOSE_FILE) {
+                file.close();
+            }
+            else if (file.is_open()) {
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(payload.data(), payload.size());
+                numBytesWritten += sizeof(header) + payload.size();
+            }
+
+            read += sizeof(header) + header.size;
+            readPosition.store(read, std::memory_order_release);
+        }
+
+        if (file.is_open()) {
+            file.flush();
+        }
+        if (stop) {
+            break;
+        }
+        std::this_thread::sleep_for(WRITER_POLL_INTERVAL);
+    }
+}
+
+void SnapshotRecorder::OpenFile(const std::filesystem::path& path) {
+    auto pathUtf8 = path.u8string();
+    // If the switch can't be queued, nothing more is recorded until the next OpenFile(), rather than going to the
+    // wrong file
+    recording = Push(CONTROL_OPEN_FILE, 0, pathUtf8.data(), static_cast<uint32_t>(pathUtf8.size()))
+        && Push(SNAPSHOT_SESSION, 0, nullptr, 0);
+}
+
+void SnapshotRecorder::CloseFile() {
+    if (recording) {
+        recording = false;
+        Push(CONTROL_CLOSE_FILE, 0, nullptr, 0);
+    }
+}
+
+void SnapshotRecorder::RecordInput(double gameTimeMs, const InferenceInput& input) {
+    if (!recording) {
+        return;
+    }
+    SnapshotInputRecord record;
+    std::copy(input.inputs.begin(), input.inputs.end(), record.inputs);
+    record.reliability = input.reliability;
+    Push(SNAPSHOT_INPUT, gameTimeMs, record);
+}
+
+void SnapshotRecorder::RecordPrediction(double gameTimeMs, const Prediction& prediction) {
+    if (!recording) {
+        return;
+    }
+    SnapshotPredictionRecord record = {
+        prediction.prob_blue, prediction.prob_orange, static_cast<uint32_t>(prediction.reliability),
+        static_cast<uint32_t>(prediction.augmentation), prediction.prediction_time_ms,
+    };
+    Push(SNAPSHOT_PREDICTION, gameTimeMs, record);
+}
+
+void SnapshotRecorder::RecordEvent(double gameTimeMs, const SecondEvent& event) {
+    if (recording) {
+        Push(SNAPSHOT_SECOND, gameTimeMs, SnapshotSecondRecord{ event.second, event.overtime });
+    }
+}
+
+void SnapshotRecorder::RecordEvent(double gameTimeMs, const BallHitEvent& event) {
+    if (recording) {
+        Push(SNAPSHOT_BALL_HIT, gameTimeMs, SnapshotTeamRecord{ event.orange });
+    }
+}
+
+void SnapshotRecorder::RecordEvent(double gameTimeMs, const DemolitionEvent& event) {
+    if (recording) {
+        Push(SNAPSHOT_DEMOLITION, gameTimeMs, SnapshotDemolitionRecord{ event.victim_orange, event.victim_id, event.victim_index });
+    }
+}
+
+void SnapshotRecorder::RecordEvent(double gameTimeMs, const GoalEvent& event) {
+    if (recording) {
+        Push(SNAPSHOT_GOAL, gameTimeMs, SnapshotTeamRecord{ event.orange_scored });
+    }
+}
+
+void SnapshotRecorder::RecordEvent(double gameTimeMs, const KickoffEvent&) {
+    if (recording) {
+        Push(SNAPSHOT_KICKOFF, gameTimeMs, nullptr, 0);
+    }
+}
+
+void SnapshotRecorder::RecordEvent(double gameTimeMs, const BigBoostPickupEvent& event) {
+    if (recording) {
+        Push(SNAPSHOT_BIG_BOOST_PICKUP, gameTimeMs, SnapshotBigBoostPickupRecord{ event.boost_index });
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "GameEvents.h"
+#include "InferenceEngine.h"
+#include "SnapshotFormat.h"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Records model inputs, game events and predictions to binary snapshot files (see SnapshotFormat.h), to replay real
+// workloads offline. The game thread only copies each record into a fixed size ring buffer; a background thread
+// drains the ring into the file. If the writer falls behind far enough for the ring to fill up, records are dropped
+// and counted rather than blocking the game thread.
+// All methods other than the getters must be called from one thread (the game thread).
+class SnapshotRecorder {
+private:
+    static constexpr size_t RING_CAPACITY = 4 * 1024 * 1024;
+
+    // Control records which tell the writer to switch files, never written out
+    static constexpr uint8_t CONTROL_OPEN_FILE = 0xF0; // Payload is the UTF-8 path
+    static constexpr uint8_t CONTROL_CLOSE_FILE = 0xF1;
+
+    // Single producer, single consumer byte ring. Positions only ever increase, and wrap when indexing.
+    std::unique_ptr<char[]> ring = std::make_unique<char[]>(RING_CAPACITY);
+    std::atomic<uint64_t> writePosition = 0;
+    std::atomic<uint64_t> readPosition = 0;
+
+    std::thread writer;
+    std::atomic<bool> stopping = false;
+    bool recording = false; // Between OpenFile() and CloseFile(), only touched by the producer
+
+    std::atomic<uint64_t> numDropped = 0;
+    std::atomic<uint64_t> numBytesWritten = 0;
+
+    bool Push(uint8_t type, double gameTimeMs, const void* payload, uint32_t size);
+    template <typename T>
+    bool Push(SnapshotRecordType type, double gameTimeMs, const T& payload) {
+        return Push(type, gameTimeMs, &payload, sizeof(payload));
+    }
+
+    void CopyOut(uint64_t position, void* out, size_t size) const;
+    void RunWriter();
+
+public:
+    ~SnapshotRecorder();
+
+    // Starts the writer thread if it isn't running yet.
+    void Start();
+    // Writes out everything recorded so far, then stops the writer thread.
+    void Stop();
+
+    // Ends any current file, and appends further records to path.
+    void OpenFile(const std::filesystem::path& path);
+    void CloseFile();
+    bool IsRecording() const { return recording; }
+
+    void RecordInput(double gameTimeMs, const InferenceInput& input);
+    void RecordPrediction(double gameTimeMs, const Prediction& prediction);
+    void RecordEvent(double gameTimeMs, const SecondEvent& event);
+    void RecordEvent(double gameTimeMs, const BallHitEvent& event);
+    void RecordEvent(double gameTimeMs, const DemolitionEvent& event);
+    void RecordEvent(double gameTimeMs, const GoalEvent& event);
+    void RecordEvent(double gameTimeMs, const KickoffEvent& event);
+    void RecordEvent(double gameTimeMs, const BigBoostPickupEvent& event);
+
+    uint64_t GetNumDropped() const { return numDropped; }
+    uint64_t GetNumBytesWritten() const { return numBytesWritten; }
+};
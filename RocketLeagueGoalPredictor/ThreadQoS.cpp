@@ -0,0 +1,127 @@
+#include "ThreadQoS.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Nice value for lowPriority on Linux, roughly matching THREAD_PRIORITY_BELOW_NORMAL on Windows
+static const int LOW_PRIORITY_NICE = 5;
+
+// The logical processors of each physical core, ordered by their lowest logical processor. Each logical processor is
+// its own core if the topology can't be read.
+static std::vector<std::vector<int>> GetPhysicalCores() {
+    std::vector<std::vector<int>> cores;
+#ifdef _WIN32
+    // Only the first processor group, since SetThreadAffinityMask() can't reach past its 64 logical processors
+    DWORD size = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &size);
+    std::vector<char> buffer(size);
+    if (size > 0 && GetLogicalProcessorInformationEx(RelationProcessorCore,
+            reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()), &size)) {
+        for (DWORD offset = 0; offset < size;) {
+            auto info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+            offset += info->Size;
+            const GROUP_AFFINITY& affinity = info->Processor.GroupMask[0];
+            if (info->Processor.GroupCount != 1 || affinity.Group != 0) {
+                continue;
+            }
+            std::vector<int> core;
+            for (int processor = 0; processor < 64; processor++) {
+                if (affinity.Mask & (static_cast<KAFFINITY>(1) << processor)) {
+                    core.push_back(processor);
+                }
+            }
+            cores.push_back(std::move(core));
+        }
+    }
+    int numProcessors = std::min(static_cast<int>(std::thread::hardware_concurrency()), 64);
+#else
+    // Siblings share a package and core id
+    std::map<std::pair<int, int>, std::vector<int>> coresById;
+    int numProcessors = static_cast<int>(std::thread::hardware_concurrency());
+    for (int processor = 0; processor < numProcessors; processor++) {
+        std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(processor) + "/topology/";
+        int packageId = -1;
+        int coreId = -1;
+        std::ifstream(topology + "physical_package_id") >> packageId;
+        std::ifstream(topology + "core_id") >> coreId;
+        if (packageId < 0 || coreId < 0) {
+            coresById.clear();
+            break;
+        }
+        coresById[{ packageId, coreId }].push_back(processor);
+    }
+    for (auto& [id, core] : coresById) {
+        cores.push_back(std::move(core));
+    }
+#endif
+    if (cores.empty()) {
+        for (int processor = 0; processor < numProcessors; processor++) {
+            cores.push_back({ processor });
+        }
+    }
+    std::sort(cores.begin(), cores.end());
+    return cores;
+}
+
+static bool PinToLastCores(int numLastCores) {
+    auto cores = GetPhysicalCores();
+    if (cores.empty()) {
+        return false;
+    }
+    size_t firstCore = cores.size() - std::min(cores.size(), static_cast<size_t>(numLastCores));
+
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (size_t core = firstCore; core < cores.size(); core++) {
+        for (int processor : cores[core]) {
+            mask |= static_cast<DWORD_PTR>(1) << processor;
+        }
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (size_t core = firstCore; core < cores.size(); core++) {
+        for (int processor : cores[core]) {
+            CPU_SET(processor, &cpuSet);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#endif
+}
+
+static bool LowerPriority() {
+#ifdef _WIN32
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL) != 0;
+#else
+    // On Linux, nice values apply per thread when given a thread id
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    return setpriority(PRIO_PROCESS, tid, LOW_PRIORITY_NICE) == 0;
+#endif
+}
+
+bool ApplyThreadQoS(const ThreadQoS& qos) {
+    bool success = true;
+    if (qos.numLastCores > 0) {
+        success &= PinToLastCores(qos.numLastCores);
+    }
+    if (qos.lowPriority) {
+        success &= LowerPriority();
+    }
+    return success;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Scheduling settings for background worker threads, so they don't compete with the game and render threads.
+struct ThreadQoS {
+    // Pin to this many of the highest numbered physical cores, including all of their SMT siblings, or 0 to leave
+    // affinity alone. Whole physical cores, so two lanes never share one through hyperthreading while others sit idle.
+    int numLastCores = 0;
+    bool lowPriority = true; // Run below normal priority
+};
+
+// Applies qos to the calling thread. Returns false if any part of it couldn't be applied.
+bool ApplyThreadQoS(const ThreadQoS& qos);
@@ -0,0 +1,117 @@
+#pragma once
+#include "MemoryUsage.h"
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+// Powers of two so bucket boundaries are exact in floating point
+const double PYRAMID_BASE_BUCKET_MS = 128;
+const int PYRAMID_NUM_LEVELS = 16; // Coarsest buckets are ~70 minutes, longer than any match
+
+// Event types opt in to a pyramid by defining a Summary which can be built from one event and merged with another.
+template <typename T>
+concept Summarizable = requires(const T& event, typename T::Summary summary) {
+    { T::Summary::Of(event) } -> std::same_as<typename T::Summary>;
+    summary.Merge(summary);
+};
+
+// Multi-resolution summaries over a time series, for drawing long histories at a cost bounded by the number of
+// pixels rather than events. Level L has buckets PYRAMID_BASE_BUCKET_MS * 2^L wide, each the merge of its two children,
+// with empty buckets left out. Any change to the series is applied with Update(), which rebuilds the affected base
+// buckets from the series and then their ancestors, so replacing events (e.g. rewinding a replay) works the same as
+// adding them.
+template <typename T>
+class TimeSeriesPyramid {
+private:
+    using Summary = typename T::Summary;
+
+    std::array<std::unordered_map<int64_t, Summary>, PYRAMID_NUM_LEVELS> levels;
+
+    static double GetBucketWidthMs(int level) {
+        return PYRAMID_BASE_BUCKET_MS * static_cast<double>(int64_t(1) << level);
+    }
+
+    static int64_t GetBucketIndex(double timeMs, int level) {
+        return static_cast<int64_t>(std::floor(timeMs / GetBucketWidthMs(level)));
+    }
+
+    static void MergeInto(std::optional<Summary>& summary, const Summary& other) {
+        if (summary) {
+            summary->Merge(other);
+        }
+        else {
+            summary = other;
+        }
+    }
+
+    void SetBucket(int level, int64_t index, const std::optional<Summary>& summary) {
+        if (summary) {
+            levels[level].insert_or_assign(index, summary.value());
+        }
+        else {
+            levels[level].erase(index);
+        }
+    }
+
+    // O(events in the base bucket + levels)
+    void UpdateBucket(const std::map<double, T>& map, int64_t index) {
+        double startMs = index * PYRAMID_BASE_BUCKET_MS;
+        std::optional<Summary> summary;
+        for (auto it = map.lower_bound(startMs), end = map.lower_bound(startMs + PYRAMID_BASE_BUCKET_MS); it != end; ++it) {
+            MergeInto(summary, Summary::Of(it->second));
+        }
+        SetBucket(0, index, summary);
+
+        for (int level = 1; level < PYRAMID_NUM_LEVELS; level++) {
+            index >>= 1; // Arithmetic shift floors, so negative times work too
+            const auto& children = levels[level - 1];
+            std::optional<Summary> merged;
+            if (auto left = children.find(index * 2); left != children.end()) {
+                MergeInto(merged, left->second);
+            }
+            if (auto right = children.find(index * 2 + 1); right != children.end()) {
+                MergeInto(merged, right->second);
+            }
+            SetBucket(level, index, merged);
+        }
+    }
+
+public:
+    // Rebuilds everything covering [minTimeMs, maxTimeMs] after map changed anywhere in that range.
+    void Update(const std::map<double, T>& map, double minTimeMs, double maxTimeMs) {
+        for (int64_t index = GetBucketIndex(minTimeMs, 0); index <= GetBucketIndex(maxTimeMs, 0); index++) {
+            UpdateBucket(map, index);
+        }
+    }
+
+    size_t GetMemoryUsageBytes() const {
+        size_t bytes = 0;
+        for (const auto& buckets : levels) {
+            bytes += buckets.size() * (sizeof(typename std::unordered_map<int64_t, Summary>::value_type) + HASH_NODE_OVERHEAD_BYTES);
+            bytes += buckets.bucket_count() * sizeof(void*);
+        }
+        return bytes;
+    }
+
+    // Calls fn(bucketStartMs, bucketWidthMs, summary) in time order for each non-empty bucket overlapping
+    // [minTimeMs, maxTimeMs], at the finest level whose buckets are at least minBucketWidthMs wide.
+    template <typename F>
+    void ForEachSummary(double minTimeMs, double maxTimeMs, double minBucketWidthMs, F&& fn) const {
+        int level = 0;
+        while (level < PYRAMID_NUM_LEVELS - 1 && GetBucketWidthMs(level) < minBucketWidthMs) {
+            level++;
+        }
+
+        double widthMs = GetBucketWidthMs(level);
+        const auto& buckets = levels[level];
+        for (int64_t index = GetBucketIndex(minTimeMs, level); index <= GetBucketIndex(maxTimeMs, level); index++) {
+            if (auto it = buckets.find(index); it != buckets.end()) {
+                fn(index * widthMs, widthMs, it->second);
+            }
+        }
+    }
+};
@@ -1,70 +1,154 @@
 #pragma once
+#include "MemoryUsage.h"
+#include "MpscQueue.h"
 #include <chrono>
-#include <future>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+// A set of background tasks each tagged with a time. Workers push their results onto a lock-free completion queue
+// when they finish, so collecting them is O(completed) rather than polling every pending task, and pending times are
+// kept ordered for O(log n) closest-time lookups.
+// Clear() doesn't wait for running tasks: it bumps a generation counter, so tasks from earlier generations are skipped
+// if they haven't started yet and their results are discarded if they have.
 template <typename T>
 class TimedTaskSet {
 private:
-    struct TaskEntry {
+    struct Completion {
+        uint64_t id;
         double timeMs;
-        std::future<T> task;
+        T result;
     };
 
-    std::vector<TaskEntry> tasks;
+    // Shared with the worker threads, which may outlive a Clear()
+    struct SharedState {
+        MpscQueue<Completion> completed;
+        std::atomic<int> numRunning = 0;
+        std::atomic<uint64_t> generation = 0;
+        std::mutex idleMutex;
+        std::condition_variable idle;
+    };
+
+    // Counts a task as running until its job is destroyed, whether it ran or a thread pool discarded it
+    struct RunningTask {
+        std::shared_ptr<SharedState> state;
+
+        explicit RunningTask(std::shared_ptr<SharedState> state) : state(std::move(state)) {
+            this->state->numRunning++;
+        }
+        RunningTask(const RunningTask&) = delete;
+        RunningTask& operator=(const RunningTask&) = delete;
+
+        ~RunningTask() {
+            if (--state->numRunning == 0) {
+                std::lock_guard lock(state->idleMutex);
+                state->idle.notify_all();
+            }
+        }
+    };
+
+    std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+    std::multiset<double> pendingTimesMs;
+    std::unordered_map<uint64_t, std::multiset<double>::iterator> pendingById;
+    uint64_t nextId = 0;
 
 public:
-    void Add(double timeMs, std::future<T> task) {
-        tasks.push_back(TaskEntry{ timeMs, std::move(task) });
+    // Runs task on a worker thread, whose result will be returned by GetCompletedTasks() once finished.
+    // By default each task gets a new thread, but launch(job) can hand the job to an existing thread pool instead,
+    // which must either call job(args...) once, passing through any arguments task takes, or destroy it unrun.
+    template <typename F, typename Launch>
+    void Add(double timeMs, F&& task, Launch&& launch) {
+        uint64_t id = nextId++;
+        pendingById.emplace(id, pendingTimesMs.insert(timeMs));
+
+        auto running = std::make_shared<RunningTask>(state);
+        launch([running = std::move(running), generation = GetGeneration(), id, timeMs, task = std::forward<F>(task)](auto&... args) mutable {
+            auto& state = running->state;
+            if (state->generation == generation) {
+                state->completed.Push(Completion{ id, timeMs, task(args...) });
+            }
+        });
+    }
+
+    template <typename F>
+    void Add(double timeMs, F&& task) {
+        Add(timeMs, std::forward<F>(task), [](auto job) {
+            std::thread(std::move(job)).detach();
+        });
     }
 
     std::vector<std::pair<double, T>> GetCompletedTasks() {
         std::vector<std::pair<double, T>> results;
 
-        for (auto it = tasks.begin(); it != tasks.end(); /* increment inside */) {
-            if (!it->task.valid()) {
-                it = tasks.erase(it);
-            }
-            else if (it->task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                results.push_back({ it->timeMs, it->task.get() });
-                it = tasks.erase(it);
-            }
-            else {
-                ++it;
+        while (auto completion = state->completed.TryPop()) {
+            auto it = pendingById.find(completion->id);
+            if (it == pendingById.end()) {
+                continue; // From before a Clear()
             }
+            pendingTimesMs.erase(it->second);
+            pendingById.erase(it);
+
+            results.push_back({ completion->timeMs, std::move(completion->result) });
         }
 
         return results;
     }
 
     std::optional<double> GetClosestTimeMs(double timeMs) const {
-        if (tasks.empty()) {
+        if (pendingTimesMs.empty()) {
             return std::nullopt;
         }
 
-        double closestTimeMs = tasks[0].timeMs;
-        double minDiffMs = std::abs(closestTimeMs - timeMs);
-        for (size_t i = 1; i < tasks.size(); ++i) {
-            double diff = std::abs(tasks[i].timeMs - timeMs);
-            if (diff < minDiffMs) {
-                minDiffMs = diff;
-                closestTimeMs = tasks[i].timeMs;
-            }
+        auto it_next = pendingTimesMs.lower_bound(timeMs);
+        if (it_next == pendingTimesMs.begin()) {
+            return *it_next;
+        }
+        auto it_prev = std::prev(it_next);
+        if (it_next == pendingTimesMs.end()) {
+            return *it_prev;
         }
 
-        return closestTimeMs;
+        return timeMs - *it_prev <= *it_next - timeMs ? *it_prev : *it_next;
     }
 
-    void WaitAllAndClear() {
-        for (auto& entry : tasks) {
-            if (entry.task.valid()) {
-                entry.task.wait();
-            }
-        }
-        tasks.clear();
+    // Number of tasks added since the last Clear() whose results haven't been collected yet.
+    size_t GetNumPending() const {
+        return pendingById.size();
+    }
+
+    // Approximate heap usage of the pending task bookkeeping, not counting whatever the tasks themselves hold on to.
+    size_t GetMemoryUsageBytes() const {
+        return pendingTimesMs.size() * (sizeof(double) + MAP_NODE_OVERHEAD_BYTES)
+            + pendingById.size() * (sizeof(typename decltype(pendingById)::value_type) + HASH_NODE_OVERHEAD_BYTES)
+            + pendingById.bucket_count() * sizeof(void*);
+    }
+
+    uint64_t GetGeneration() const {
+        return state->generation;
+    }
+
+    // Forgets all pending tasks without waiting for them.
+    void Clear() {
+        state->generation++;
+        while (state->completed.TryPop()) {}
+        pendingTimesMs.clear();
+        pendingById.clear();
+    }
+
+    // Waits for all running tasks, including ones from before a Clear(), to finish. Returns false on timeout.
+    bool WaitAll(std::chrono::milliseconds timeout) {
+        std::unique_lock lock(state->idleMutex);
+        return state->idle.wait_for(lock, timeout, [this] { return state->numRunning == 0; });
     }
 
     ~TimedTaskSet() {
-        WaitAllAndClear();
+        Clear();
     }
-};
\ No newline at end of file
+};
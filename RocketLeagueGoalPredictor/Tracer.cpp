@@ -0,0 +1,146 @@
+#include "Tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const size_t TRACE_RING_CAPACITY = 16384; // Events kept per thread, ~400 KB each
+// Events this close behind the write position may be mid-overwrite while dumping, so leave them out
+static const size_t TRACE_DUMP_MARGIN = 64;
+
+struct TraceEvent {
+    const char* name;
+    int64_t startUs;
+    int64_t durationUs;
+};
+
+struct TraceRing {
+    int tid;
+    std::atomic<const char*> threadName = nullptr;
+    std::unique_ptr<TraceEvent[]> events = std::make_unique<TraceEvent[]>(TRACE_RING_CAPACITY);
+    std::atomic<uint64_t> numWritten = 0; // Only the owning thread writes
+    std::atomic<bool> inUse = true; // Cleared when the owning thread exits
+};
+
+static std::atomic<bool> tracingEnabled = false;
+static const auto traceEpoch = std::chrono::steady_clock::now();
+
+// Rings outlive their threads so their events can still be dumped afterwards, until a new thread takes the ring over.
+// Reusing them keeps memory bounded by the most threads tracing at once, however often the inference pool restarts.
+static std::mutex ringsMutex;
+static std::vector<std::unique_ptr<TraceRing>> rings;
+static int lastTid = 0;
+
+// Hands the calling thread's ring back for reuse when the thread exits
+struct ThreadRingOwner {
+    TraceRing* ring = nullptr;
+
+    ~ThreadRingOwner() {
+        if (ring) {
+            ring->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+// Rings are only allocated once a thread records its first event, so threads which never trace cost nothing
+static thread_local ThreadRingOwner threadRing;
+static thread_local const char* threadName = nullptr;
+
+static TraceRing& GetThreadRing() {
+    if (!threadRing.ring) {
+        std::lock_guard lock(ringsMutex);
+        auto freeRing = std::find_if(rings.begin(), rings.end(), [](const auto& ring) {
+            return !ring->inUse.load(std::memory_order_acquire);
+        });
+        if (freeRing == rings.end()) {
+            rings.push_back(std::make_unique<TraceRing>());
+            freeRing = rings.end() - 1;
+        }
+        TraceRing& ring = **freeRing;
+        ring.inUse.store(true, std::memory_order_relaxed);
+        ring.tid = ++lastTid; // A new thread in the trace output, rather than continuing the previous owner's
+        ring.threadName.store(threadName, std::memory_order_relaxed);
+        ring.numWritten.store(0, std::memory_order_relaxed);
+        threadRing.ring = &ring;
+    }
+    return *threadRing.ring;
+}
+
+void SetTracingEnabled(bool enabled) {
+    tracingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsTracingEnabled() {
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+void SetTraceThreadName(const char* name) {
+    threadName = name;
+    if (threadRing.ring) {
+        threadRing.ring->threadName.store(name, std::memory_order_relaxed);
+    }
+}
+
+void RecordTraceEvent(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    auto& ring = GetThreadRing();
+    uint64_t index = ring.numWritten.load(std::memory_order_relaxed);
+    ring.events[index % TRACE_RING_CAPACITY] = {
+        name,
+        std::chrono::duration_cast<std::chrono::microseconds>(start - traceEpoch).count(),
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+    };
+    ring.numWritten.store(index + 1, std::memory_order_release);
+}
+
+// Trace names are all literals from our own code, but escape anyway so the output is always valid JSON
+static void WriteJsonString(std::ofstream& out, const char* str) {
+    out << '"';
+    for (const char* c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+int WriteTraceJson(const std::filesystem::path& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        return -1;
+    }
+
+    int numEvents = 0;
+    bool first = true;
+    auto separator = [&]() -> std::ofstream& {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        return out;
+    };
+
+    out << "{\"traceEvents\":[";
+    std::lock_guard lock(ringsMutex);
+    for (const auto& ring : rings) {
+        if (const char* name = ring->threadName.load(std::memory_order_relaxed)) {
+            separator() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->tid << ",\"args\":{\"name\":";
+            WriteJsonString(out, name);
+            out << "}}";
+        }
+
+        uint64_t end = ring->numWritten.load(std::memory_order_acquire);
+        uint64_t keep = TRACE_RING_CAPACITY - TRACE_DUMP_MARGIN;
+        uint64_t begin = end > keep ? end - keep : 0;
+        for (uint64_t i = begin; i < end; i++) {
+            const auto& event = ring->events[i % TRACE_RING_CAPACITY];
+            separator() << "{\"ph\":\"X\",\"name\":";
+            WriteJsonString(out, event.name);
+            out << ",\"pid\":1,\"tid\":" << ring->tid << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+            numEvents++;
+        }
+    }
+    out << "\n]}\n";
+
+    return out ? numEvents : -1;
+}
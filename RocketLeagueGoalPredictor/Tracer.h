@@ -0,0 +1,41 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+// Low overhead tracing of named scopes into a preallocated ring buffer per thread, which can be written out as
+// Chrome trace event JSON (chrome://tracing or https://ui.perfetto.dev) to see how the game, render and inference
+// threads interleave. Recording is a couple of clock reads and stores when enabled, and a relaxed load when not.
+
+void SetTracingEnabled(bool enabled);
+bool IsTracingEnabled();
+
+// Names the calling thread in the trace output. name must outlive the trace, e.g. a string literal.
+void SetTraceThreadName(const char* name);
+
+// Records a complete event on the calling thread. name must outlive the trace, e.g. a string literal.
+void RecordTraceEvent(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+// Writes the recorded events from every thread to path. Recording may continue while this runs, though events being
+// overwritten at the same time may come out garbled. Returns the number of events written, or -1 on failure.
+int WriteTraceJson(const std::filesystem::path& path);
+
+// Traces the enclosing scope if tracing is enabled when it starts.
+class ScopedTrace {
+private:
+    const char* name;
+    bool enabled = IsTracingEnabled();
+    std::chrono::steady_clock::time_point startTime = enabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+public:
+    explicit ScopedTrace(const char* name) : name(name) {}
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+    ~ScopedTrace() {
+        if (enabled) {
+            RecordTraceEvent(name, startTime, std::chrono::steady_clock::now());
+        }
+    }
+};
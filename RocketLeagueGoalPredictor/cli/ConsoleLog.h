@@ -0,0 +1,11 @@
+#pragma once
+#include "../LogSink.h"
+#include <cstdint>
+#include <cstdio>
+
+// Writes out queued LOG() records to stderr. Only one thread at a time may flush, see FlushLogRecords().
+inline void FlushLogToStderr() {
+    FlushLogRecords(SIZE_MAX, [](std::string_view line) {
+        std::fprintf(stderr, "%.*s\n", static_cast<int>(line.size()), line.data());
+    });
+}
@@ -0,0 +1,292 @@
+#include "KaggleCsvParser.h"
+#include "../FeatureBuilder.h"
+#include "../LogSink.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define CSV_PARSER_SSE2 1
+#endif
+
+static const float NOT_A_NUMBER = std::numeric_limits<float>::quiet_NaN();
+
+// Powers of ten that are exact as floats. A float mantissa up to 2^24 divided by one of these is correctly rounded.
+static const float EXACT_POWERS_OF_TEN[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+static const uint64_t INTEGER_POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+static const uint64_t MAX_EXACT_MANTISSA = 1 << 24;
+static const int MAX_MANTISSA_DIGITS = 19; // Fits a uint64_t
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// SWAR digit parsing on 8 bytes at once, from simdjson / fast_float. Only valid on little endian targets, where the
+// first character is the lowest byte.
+static uint64_t LoadEightBytes(const char* text) {
+    uint64_t value;
+    std::memcpy(&value, text, sizeof(value));
+    return value;
+}
+
+static bool IsEightDigits(uint64_t chars) {
+    return (((chars & 0xF0F0F0F0F0F0F0F0) | (((chars + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333);
+}
+
+// Number of digits before the first non-digit, or 8 if they all are.
+static int CountLeadingDigits(uint64_t chars) {
+    const uint64_t HIGH_BITS = 0x8080808080808080;
+    uint64_t atLeastZero = ((chars | HIGH_BITS) - 0x3030303030303030) & HIGH_BITS; // No borrows between bytes
+    uint64_t aboveNine = ((chars & ~HIGH_BITS) + 0x4646464646464646) & HIGH_BITS; // No carries between bytes
+    uint64_t nonDigits = (~atLeastZero | aboveNine | chars) & HIGH_BITS;
+    return std::countr_zero(nonDigits) / 8;
+}
+
+// Value of 8 digits. Zero bytes count as leading zeros, so shifting a shorter run up to the top parses it too.
+static uint32_t ParseEightDigits(uint64_t chars) {
+    chars = (chars & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+    chars = (chars & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+    return static_cast<uint32_t>((chars & 0x0000FFFF0000FFFF) * 42949672960001 >> 32);
+}
+
+// Value of the first numDigits (1 to 8) digits of chars.
+static uint32_t ParseLeadingDigits(uint64_t chars, int numDigits) {
+    return ParseEightDigits(chars << (64 - 8 * numDigits));
+}
+
+// Accumulates the digits starting at p into mantissa, returning the number of them.
+static int ParseDigits(const char*& p, const char* end, uint64_t& mantissa) {
+    const char* start = p;
+    if constexpr (std::endian::native == std::endian::little) {
+        while (end - p >= 8 && IsEightDigits(LoadEightBytes(p))) {
+            mantissa = mantissa * 100000000 + ParseEightDigits(LoadEightBytes(p));
+            p += 8;
+        }
+    }
+    while (p != end && IsDigit(*p)) {
+        mantissa = mantissa * 10 + (*p - '0');
+        p++;
+    }
+    return static_cast<int>(p - start);
+}
+
+static bool ToFloat(uint64_t mantissa, int numFractionDigits, bool negative, float& value) {
+    if (mantissa > MAX_EXACT_MANTISSA || numFractionDigits >= static_cast<int>(std::size(EXACT_POWERS_OF_TEN))) {
+        return false;
+    }
+    value = static_cast<float>(mantissa) / EXACT_POWERS_OF_TEN[numFractionDigits];
+    value = negative ? -value : value;
+    return true;
+}
+
+// Parses a field, which may be followed by anything up to readableEnd. Plain decimals with up to 7 digits on each side
+// of the point, like nearly every field in the Kaggle data, take a fixed sequence of 8 byte loads without any loops.
+static bool ParseFloatField(const char* begin, const char* end, const char* readableEnd, float& value) {
+    if (begin == end) {
+        value = NOT_A_NUMBER;
+        return true;
+    }
+
+    const char* p = begin;
+    bool negative = *p == '-';
+    p += negative;
+
+    if constexpr (std::endian::native == std::endian::little) {
+        if (readableEnd - p >= 17) {
+            uint64_t integerChars = LoadEightBytes(p);
+            int numIntegerDigits = CountLeadingDigits(integerChars);
+            uint64_t integerPart = numIntegerDigits > 0 && numIntegerDigits < 8 ? ParseLeadingDigits(integerChars, numIntegerDigits) : 0;
+            const char* point = p + numIntegerDigits;
+            if (numIntegerDigits > 0 && numIntegerDigits < 8) {
+                if (point == end && ToFloat(integerPart, 0, negative, value)) {
+                    return true;
+                }
+                if (*point == '.') {
+                    uint64_t fractionChars = LoadEightBytes(point + 1);
+                    int numFractionDigits = CountLeadingDigits(fractionChars);
+                    if (numFractionDigits > 0 && numFractionDigits < 8 && point + 1 + numFractionDigits == end) {
+                        uint64_t mantissa = integerPart * INTEGER_POWERS_OF_TEN[numFractionDigits]
+                            + ParseLeadingDigits(fractionChars, numFractionDigits);
+                        if (ToFloat(mantissa, numFractionDigits, negative, value)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // General path for plain decimals with any number of digits
+    uint64_t mantissa = 0;
+    int numDigits = ParseDigits(p, end, mantissa);
+    int numFractionDigits = 0;
+    if (p != end && *p == '.') {
+        p++;
+        numFractionDigits = ParseDigits(p, end, mantissa);
+        numDigits += numFractionDigits;
+    }
+    if (p == end && numDigits > 0 && numDigits <= MAX_MANTISSA_DIGITS && ToFloat(mantissa, numFractionDigits, negative, value)) {
+        return true;
+    }
+
+    std::string_view field(begin, end - begin);
+    if (field == "null" || field == "nan" || field == "NaN") {
+        value = NOT_A_NUMBER;
+        return true;
+    }
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool ParseCsvFloat(const char* begin, const char* end, float& value) {
+    return ParseFloatField(begin, end, end, value);
+}
+
+// Bitmask of the ',' and '\n' bytes in the 64 bytes at block.
+static uint64_t FindDelimiters64(const char* block) {
+#ifdef CSV_PARSER_SSE2
+    const __m128i commas = _mm_set1_epi8(',');
+    const __m128i newlines = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(bytes, commas), _mm_cmpeq_epi8(bytes, newlines));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(matches))) << (16 * i);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        mask |= static_cast<uint64_t>(block[i] == ',' || block[i] == '\n') << i;
+    }
+    return mask;
+#endif
+}
+
+const char* KaggleCsvParser::FindDelimiter(const char* from) {
+    while (true) {
+        if (hasBlock && from >= blockStart && from - blockStart < 64) {
+            uint64_t remaining = blockMask & (~uint64_t(0) << (from - blockStart));
+            if (remaining != 0) {
+                return blockStart + std::countr_zero(remaining);
+            }
+            from = blockStart + 64;
+        }
+        if (from >= end) {
+            return end;
+        }
+
+        blockStart = from;
+        hasBlock = true;
+        if (end - from >= 64) {
+            blockMask = FindDelimiters64(from);
+        }
+        else {
+            // Tail of the file, which can't be loaded 64 bytes at a time
+            blockMask = 0;
+            for (int i = 0; i < end - from; i++) {
+                blockMask |= static_cast<uint64_t>(from[i] == ',' || from[i] == '\n') << i;
+            }
+        }
+    }
+}
+
+bool KaggleCsvParser::Begin(const char* fileData, size_t size) {
+    data = fileData;
+    end = fileData + size;
+    fileEnd = end;
+    position = fileData;
+    hasBlock = false;
+
+    int numColumns = 0;
+    while (position < end) {
+        const char* delimiter = FindDelimiter(position);
+        std::string_view field(position, delimiter - position);
+        if (!field.empty() && field.back() == '\r') {
+            field.remove_suffix(1);
+        }
+        hasIdColumn |= numColumns == 0 && field == "id";
+        numColumns++;
+        position = delimiter < end ? delimiter + 1 : end;
+        if (delimiter == end || *delimiter == '\n') {
+            break;
+        }
+    }
+    lineNumber = 1;
+    rowsBegin = position;
+
+    if (numColumns - hasIdColumn != INPUT_DIM) {
+        LOG("CSV has {} input columns besides id, expected {}", numColumns - hasIdColumn, INPUT_DIM);
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+size_t KaggleCsvParser::Parse(float* rows, int64_t* ids, size_t maxRows) {
+    size_t numParsed = 0;
+    while (numParsed < maxRows && position < end && !failed) {
+        lineNumber += lineNumber > 0;
+        if (*position == '\n' || (*position == '\r' && end - position > 1 && position[1] == '\n')) {
+            position += *position == '\r' ? 2 : 1; // Blank line, e.g. at the end of the file
+            continue;
+        }
+
+        float* row = rows + numParsed * INPUT_DIM;
+        const char* fieldStart = position;
+        const char* delimiter = position;
+        bool valid = true;
+        if (hasIdColumn) {
+            delimiter = FindDelimiter(fieldStart);
+            auto result = std::from_chars(fieldStart, delimiter, ids[numParsed]);
+            valid = result.ptr == delimiter && result.ec == std::errc() && delimiter != end && *delimiter == ',';
+            fieldStart = delimiter < end ? delimiter + 1 : end;
+        }
+        else {
+            ids[numParsed] = numRows;
+        }
+
+        for (int column = 0; column < INPUT_DIM && valid; column++) {
+            delimiter = FindDelimiter(fieldStart);
+            const char* fieldEnd = delimiter;
+            if (column == INPUT_DIM - 1) {
+                valid = delimiter == end || *delimiter == '\n';
+                if (fieldEnd > fieldStart && fieldEnd[-1] == '\r') {
+                    fieldEnd--;
+                }
+            }
+            else {
+                valid = delimiter != end && *delimiter == ',';
+            }
+            valid = valid && ParseFloatField(fieldStart, fieldEnd, fileEnd, row[column]);
+            fieldStart = delimiter < end ? delimiter + 1 : end;
+        }
+
+        if (!valid) {
+            if (lineNumber > 0) {
+                LOG("Malformed CSV row on line {}", lineNumber);
+            }
+            else {
+                LOG("Malformed CSV row at byte {}", position - data);
+            }
+            failed = true;
+            break;
+        }
+        position = delimiter < end ? delimiter + 1 : end;
+        numRows++;
+        numParsed++;
+    }
+    return numParsed;
+}
+
+void KaggleCsvParser::SetRange(const char* begin, const char* rangeEnd) {
+    position = begin;
+    end = rangeEnd;
+    numRows = 0;
+    lineNumber = 0;
+    hasBlock = false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Streaming parser for CSVs in the Kaggle test set format: a header line, then an optional id column followed by the
+// INPUT_DIM model inputs on each line. Parses straight out of the (memory mapped) file into the caller's row buffers,
+// without copying fields into strings. Delimiters are found 64 bytes at a time with SSE2 where available, and plain
+// decimal numbers are parsed 8 digits at a time, falling back to std::from_chars for anything else (exponents, or more
+// digits than a float can take exactly). Empty, null and nan fields are missing values, which become NaN. Quoted
+// fields aren't supported, since the format never needs them.
+
+// Parses one field as a model input. Returns false if it isn't a number or a missing value.
+bool ParseCsvFloat(const char* begin, const char* end, float& value);
+
+class KaggleCsvParser {
+private:
+    const char* data = nullptr;
+    const char* end = nullptr;
+    const char* fileEnd = nullptr; // Past end when limited by SetRange()
+    const char* position = nullptr;
+    const char* rowsBegin = nullptr;
+    bool hasIdColumn = false;
+    int64_t numRows = 0;
+    int64_t lineNumber = 0; // 0 if unknown, see SetRange()
+    bool failed = false;
+
+    // Cached bitmask of the delimiters in [blockStart, blockStart + 64)
+    const char* blockStart = nullptr;
+    uint64_t blockMask = 0;
+    bool hasBlock = false;
+
+    // The first ',' or '\n' at or after from, or end if there are none.
+    const char* FindDelimiter(const char* from);
+
+public:
+    // Reads the header line of size bytes at data, which must stay valid while parsing. Returns false and logs why if
+    // it doesn't have INPUT_DIM columns besides an optional leading id.
+    bool Begin(const char* data, size_t size);
+
+    // Parses up to maxRows more rows into consecutive INPUT_DIM blocks of rows, and their ids (the id column, or the row
+    // index when there isn't one) into ids. Returns the number of rows parsed; a malformed row is logged and ends
+    // parsing, with the rows before it still returned.
+    size_t Parse(float* rows, int64_t* ids, size_t maxRows);
+
+    // Restricts a copy of a parser which has read the header to the rows in [begin, end), which must start at the
+    // beginning of a line, so separate parts of a file can be parsed in parallel. Without an id column, ids count from 0
+    // within the range. Errors give byte offsets, since line numbers aren't known.
+    void SetRange(const char* begin, const char* end);
+    // The first row after the header, and the end of the file.
+    const char* GetRowsBegin() const { return rowsBegin; }
+    const char* GetEnd() const { return end; }
+
+    bool HasIdColumn() const { return hasIdColumn; }
+    bool HasFailed() const { return failed; }
+    size_t GetNumBytesParsed() const { return position - data; }
+};
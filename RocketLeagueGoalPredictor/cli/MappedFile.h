@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file, so large recordings can be read without copying them into memory first.
+class MappedFile {
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // Maps path, hinting that it will be read front to back. Returns false if it couldn't be opened or mapped.
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    // Null for an empty file.
+    const char* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+};
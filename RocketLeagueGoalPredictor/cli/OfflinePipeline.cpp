@@ -0,0 +1,375 @@
+#include "OfflinePipeline.h"
+#include "AlignedAllocator.h"
+#include "ConsoleLog.h"
+#include "KaggleCsvParser.h"
+#include "MappedFile.h"
+#include "PredictionWriter.h"
+#include "RowSource.h"
+#include "../InferenceEngine.h"
+#include "../LogSink.h"
+#include "../Tracer.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Batches in flight per worker, which bounds memory use and every stage's queue along with it
+static const size_t BATCHES_PER_WORKER = 4;
+static const size_t CACHE_LINE_BYTES = 64;
+
+enum OfflineStage {
+    OFFLINE_READ,
+    OFFLINE_BUILD,
+    OFFLINE_INFER,
+    OFFLINE_WRITE,
+    NUM_OFFLINE_STAGES,
+};
+
+static const char* const OFFLINE_STAGE_NAMES[NUM_OFFLINE_STAGES] = { "read", "build", "infer", "write" };
+
+struct OfflineBatch {
+    size_t index = 0;
+    const char* chunkBegin = nullptr; // CSV rows still to be parsed by the read stage
+    const char* chunkEnd = nullptr;
+    bool idsAreRowIndexes = false; // Ids count from 0 within the batch, and need offsetting by the rows before it
+    size_t numRows = 0;
+    std::vector<float, AlignedAllocator<float, CACHE_LINE_BYTES>> rows;
+    std::vector<int64_t> ids;
+    std::vector<double> timesMs;
+    std::vector<PredictionReliability> reliabilities;
+    std::vector<float> tensor;
+    std::vector<Prediction> predictions;
+    bool malformed = false; // The chunk had a malformed row, which ends the input
+    bool succeeded = false;
+
+    void Reserve(size_t numRowsToFit) {
+        rows.resize(numRowsToFit * INPUT_DIM);
+        ids.resize(numRowsToFit);
+        timesMs.resize(numRowsToFit);
+        reliabilities.resize(numRowsToFit);
+    }
+};
+
+struct OfflineStageStats {
+    std::atomic<uint64_t> numRows = 0;
+    std::atomic<uint64_t> busyNs = 0;
+
+    void Record(size_t rows, std::chrono::steady_clock::duration duration) {
+        numRows.fetch_add(rows, std::memory_order_relaxed);
+        busyNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+    }
+};
+
+class OfflinePipeline {
+private:
+    InferenceEngine& engine;
+    const OfflinePipelineSettings& settings;
+    PredictionWriter* writer;
+    const KaggleCsvParser* csvHeader; // Null unless reading a CSV in chunks
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable batchFree;
+    std::condition_variable batchDone;
+    std::vector<std::unique_ptr<OfflineBatch>> batches;
+    std::vector<OfflineBatch*> freeBatches;
+    std::array<std::deque<OfflineBatch*>, OFFLINE_WRITE> queues; // Input queue of each stage before writing
+    std::map<size_t, OfflineBatch*> writeQueue; // By index, since batches finish out of order
+    size_t numBatchesQueued = 0;
+    bool readingDone = false;
+    bool stopping = false;
+    std::atomic<bool> malformed = false; // Stops reading, since the non-pipelined runner ends at a malformed row too
+    std::atomic<size_t> numFailedBatches = 0;
+
+    std::array<OfflineStageStats, NUM_OFFLINE_STAGES> stats;
+
+    // Runs one stage on a batch, outside the lock.
+    void RunStage(OfflineStage stage, OfflineBatch& batch, PredictBuffers& buffers) {
+        if (stage == OFFLINE_READ) {
+            ScopedTrace trace("ParseChunk");
+            KaggleCsvParser parser = *csvHeader;
+            parser.SetRange(batch.chunkBegin, batch.chunkEnd);
+            batch.numRows = 0;
+            while (true) {
+                if (batch.numRows == batch.ids.size()) {
+                    batch.Reserve(batch.numRows + settings.batchSize);
+                }
+                size_t numParsed = parser.Parse(batch.rows.data() + batch.numRows * INPUT_DIM, batch.ids.data() + batch.numRows,
+                    batch.ids.size() - batch.numRows);
+                if (numParsed == 0) {
+                    break;
+                }
+                std::fill_n(batch.reliabilities.data() + batch.numRows, numParsed, RELIABLE); // CSVs don't record it
+                batch.numRows += numParsed;
+            }
+            batch.malformed = parser.HasFailed();
+            if (batch.malformed) {
+                malformed = true;
+            }
+            batch.idsAreRowIndexes = !parser.HasIdColumn();
+        }
+        else if (stage == OFFLINE_BUILD) {
+            ScopedTrace trace("BuildBatch");
+            engine.BuildBatchInput(batch.rows.data(), batch.numRows, settings.augmentation, batch.tensor);
+        }
+        else if (stage == OFFLINE_INFER) {
+            ScopedTrace trace("RunBatch");
+            batch.succeeded = engine.RunBatch(batch.tensor, batch.reliabilities.data(), settings.augmentation, buffers.batch_output,
+                batch.predictions);
+            if (!batch.succeeded) {
+                numFailedBatches.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void RunWorker() {
+        SetTraceThreadName("Worker");
+        PredictBuffers buffers;
+
+        std::unique_lock lock(mutex);
+        while (true) {
+            int stage = OFFLINE_INFER;
+            while (stage >= OFFLINE_READ && queues[stage].empty()) {
+                stage--;
+            }
+            if (stage < OFFLINE_READ) {
+                if (stopping) {
+                    return;
+                }
+                workAvailable.wait(lock);
+                continue;
+            }
+
+            OfflineBatch* batch = queues[stage].front();
+            queues[stage].pop_front();
+            lock.unlock();
+
+            auto startTime = std::chrono::steady_clock::now();
+            RunStage(static_cast<OfflineStage>(stage), *batch, buffers);
+            stats[stage].Record(batch->numRows, std::chrono::steady_clock::now() - startTime);
+
+            lock.lock();
+            if (stage + 1 == OFFLINE_WRITE) {
+                writeQueue[batch->index] = batch;
+                batchDone.notify_one();
+            }
+            else {
+                queues[stage + 1].push_back(batch);
+                workAvailable.notify_one();
+            }
+        }
+    }
+
+    void RunWriter() {
+        SetTraceThreadName("Writer");
+        size_t nextIndex = 0;
+        int64_t numRowsWritten = 0;
+        bool skipping = false; // After a malformed chunk, so the output ends at the same row as the input
+
+        std::unique_lock lock(mutex);
+        while (true) {
+            batchDone.wait(lock, [&] { return writeQueue.contains(nextIndex) || (readingDone && nextIndex == numBatchesQueued); });
+            auto next = writeQueue.find(nextIndex);
+            if (next == writeQueue.end()) {
+                return;
+            }
+            OfflineBatch* batch = next->second;
+            writeQueue.erase(next);
+            lock.unlock();
+
+            {
+                ScopedTrace trace("WriteBatch");
+                auto startTime = std::chrono::steady_clock::now();
+                if (batch->idsAreRowIndexes) {
+                    for (size_t i = 0; i < batch->numRows; i++) {
+                        batch->ids[i] += numRowsWritten;
+                    }
+                }
+                if (writer && !skipping) {
+                    writer->Write(batch->ids.data(), batch->timesMs.data(), batch->predictions);
+                }
+                numRowsWritten += batch->numRows;
+                skipping |= batch->malformed;
+                stats[OFFLINE_WRITE].Record(batch->predictions.size(), std::chrono::steady_clock::now() - startTime);
+            }
+
+            lock.lock();
+            freeBatches.push_back(batch);
+            batchFree.notify_one();
+            nextIndex++;
+        }
+    }
+
+    OfflineBatch* AcquireBatch() {
+        std::unique_lock lock(mutex);
+        batchFree.wait(lock, [this] { return !freeBatches.empty(); });
+        OfflineBatch* batch = freeBatches.back();
+        freeBatches.pop_back();
+        return batch;
+    }
+
+    void Queue(OfflineBatch* batch, OfflineStage stage) {
+        std::lock_guard lock(mutex);
+        batch->index = numBatchesQueued++;
+        queues[stage].push_back(batch);
+        workAvailable.notify_one();
+    }
+
+    void Release(OfflineBatch* batch) {
+        std::lock_guard lock(mutex);
+        freeBatches.push_back(batch);
+    }
+
+public:
+    OfflinePipeline(InferenceEngine& engine, const OfflinePipelineSettings& settings, PredictionWriter* writer, const KaggleCsvParser* csvHeader)
+        : engine(engine), settings(settings), writer(writer), csvHeader(csvHeader) {
+        for (size_t i = 0; i < settings.numWorkers * BATCHES_PER_WORKER; i++) {
+            batches.push_back(std::make_unique<OfflineBatch>());
+            batches.back()->Reserve(settings.batchSize);
+            freeBatches.push_back(batches.back().get());
+        }
+    }
+
+    // Splits the CSV rows into chunks of about batchSize rows, to be parsed by the read stage.
+    void QueueCsvChunks() {
+        const char* chunkBegin = csvHeader->GetRowsBegin();
+        const char* end = csvHeader->GetEnd();
+        auto firstNewline = static_cast<const char*>(std::memchr(chunkBegin, '\n', end - chunkBegin));
+        size_t bytesPerRow = firstNewline ? firstNewline + 1 - chunkBegin : end - chunkBegin;
+        size_t chunkBytes = std::max<size_t>(bytesPerRow * settings.batchSize, 1);
+
+        while (chunkBegin < end && !malformed) {
+            const char* chunkEnd = end;
+            if (static_cast<size_t>(end - chunkBegin) > chunkBytes) {
+                const char* searchStart = chunkBegin + chunkBytes - 1;
+                auto newline = static_cast<const char*>(std::memchr(searchStart, '\n', end - searchStart));
+                chunkEnd = newline ? newline + 1 : end;
+            }
+
+            OfflineBatch* batch = AcquireBatch();
+            batch->chunkBegin = chunkBegin;
+            batch->chunkEnd = chunkEnd;
+            batch->malformed = false;
+            Queue(batch, OFFLINE_READ);
+            chunkBegin = chunkEnd;
+            FlushLogToStderr();
+        }
+    }
+
+    // Reads batches in order on this thread, for inputs which can't be split up.
+    void QueueRows(RowSource& source) {
+        SetTraceThreadName("Reader");
+        while (true) {
+            OfflineBatch* batch = AcquireBatch();
+            auto startTime = std::chrono::steady_clock::now();
+            batch->Reserve(settings.batchSize);
+            {
+                ScopedTrace trace("Read");
+                batch->numRows = source.Read(batch->rows.data(), batch->ids.data(), batch->timesMs.data(), batch->reliabilities.data(),
+                    settings.batchSize);
+            }
+            stats[OFFLINE_READ].Record(batch->numRows, std::chrono::steady_clock::now() - startTime);
+            if (batch->numRows == 0) {
+                Release(batch);
+                break;
+            }
+            batch->idsAreRowIndexes = false;
+            batch->malformed = false;
+            Queue(batch, OFFLINE_BUILD);
+            FlushLogToStderr();
+        }
+        malformed = source.HasFailed();
+    }
+
+    // Runs the workers and writer while queueRead queues up the input, and waits for everything to be written.
+    template <typename QueueRead>
+    bool Run(QueueRead&& queueRead) {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < settings.numWorkers; i++) {
+            workers.emplace_back(&OfflinePipeline::RunWorker, this);
+        }
+        std::thread writerThread(&OfflinePipeline::RunWriter, this);
+
+        auto startTime = std::chrono::steady_clock::now();
+        queueRead();
+        {
+            std::lock_guard lock(mutex);
+            readingDone = true;
+        }
+        batchDone.notify_all();
+        writerThread.join();
+        double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        FlushLogToStderr();
+
+        uint64_t numRows = stats[OFFLINE_WRITE].numRows;
+        std::printf("Scored %llu rows in %zu batches with %d workers, %dx augmentation\n", static_cast<unsigned long long>(numRows),
+            numBatchesQueued, settings.numWorkers, static_cast<int>(settings.augmentation));
+        std::printf("%.3f s: %.0f rows/s\n", elapsedSeconds, numRows / elapsedSeconds);
+        // Per busy worker is what one core does on the stage, and busy workers is how many the stage kept occupied
+        std::printf("%-8s %12s %10s %18s %13s\n", "stage", "rows", "busy s", "rows/s per worker", "busy workers");
+        for (int stage = 0; stage < NUM_OFFLINE_STAGES; stage++) {
+            double busySeconds = stats[stage].busyNs / 1e9;
+            std::printf("%-8s %12llu %10.3f %18.0f %13.2f\n", OFFLINE_STAGE_NAMES[stage],
+                static_cast<unsigned long long>(stats[stage].numRows.load()), busySeconds,
+                busySeconds > 0 ? stats[stage].numRows / busySeconds : 0.0, busySeconds / elapsedSeconds);
+        }
+        if (numFailedBatches > 0) {
+            std::printf("%zu batches failed\n", numFailedBatches.load());
+        }
+        return !malformed && numFailedBatches == 0;
+    }
+};
+
+bool RunOfflinePipeline(const std::filesystem::path& inputPath, const std::filesystem::path& outputPath,
+    InferenceEngine& engine, const OfflinePipelineSettings& settings) {
+    // CSVs are mapped here and split between the workers, anything else goes through a RowSource in order
+    std::unique_ptr<RowSource> source;
+    MappedFile csvFile;
+    KaggleCsvParser csvHeader;
+    bool isCsv = inputPath.extension() == ".csv";
+    if (isCsv) {
+        if (!csvFile.Open(inputPath)) {
+            LOG("Failed to open {}", inputPath.string());
+            return false;
+        }
+        if (!csvHeader.Begin(csvFile.GetData(), csvFile.GetSize())) {
+            return false;
+        }
+    }
+    else {
+        source = OpenRowSource(inputPath);
+        if (!source) {
+            return false;
+        }
+    }
+
+    PredictionWriter writer;
+    if (!outputPath.empty() && !writer.Open(outputPath, !isCsv && source->HasTimestamps())) {
+        LOG("Failed to open {}", outputPath.string());
+        return false;
+    }
+
+    OfflinePipeline pipeline(engine, settings, writer.IsOpen() ? &writer : nullptr, isCsv ? &csvHeader : nullptr);
+    if (isCsv) {
+        return pipeline.Run([&] { pipeline.QueueCsvChunks(); });
+    }
+    return pipeline.Run([&] { pipeline.QueueRows(*source); });
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "../GameEvents.h"
+#include <cstddef>
+#include <filesystem>
+
+class InferenceEngine;
+
+struct OfflinePipelineSettings {
+    Augmentation augmentation = NO_AUGMENT;
+    size_t batchSize = 256; // Rows per session run, roughly for CSV input where batches are cut by size
+    int numWorkers = 1;
+};
+
+// Scores a whole input file as fast as the machine allows, for bulk offline analysis. Batches of rows flow through four
+// stages:
+// 1. Read: CSV chunks are parsed in parallel, snapshot files are read in order by the calling thread.
+// 2. Build: InferenceEngine::BuildBatchInput() fills the augmented input tensor.
+// 3. Infer: InferenceEngine::RunBatch(), where each worker acts as an inference lane with its own scratch buffers.
+// 4. Write: predictions are written out in input order by a writer thread.
+// Each stage has its own queue, bounded by a fixed set of batches recycled once written. Rather than a fixed number of
+// threads per stage, a shared pool of workers takes whichever stage's work is ready, preferring later stages so that
+// finished work drains before more is read. Prints the rows per second of each stage.
+// Returns false if the input was malformed, or any inference failed.
+bool RunOfflinePipeline(const std::filesystem::path& inputPath, const std::filesystem::path& outputPath,
+    InferenceEngine& engine, const OfflinePipelineSettings& settings);
@@ -0,0 +1,56 @@
+#pragma once
+#include "../GameEvents.h"
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Appends value to out in its shortest round trip form.
+template <typename T>
+void AppendCsvNumber(std::string& out, T value) {
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, result.ptr);
+}
+
+// Writes predictions as CSV, one line per input row, with the recorded game times and reliabilities (as their
+// PredictionReliability values) for inputs that have them.
+class PredictionWriter {
+private:
+    std::ofstream file;
+    bool hasTimestamps = false;
+    std::string text;
+
+public:
+    bool Open(const std::filesystem::path& path, bool withTimestamps) {
+        hasTimestamps = withTimestamps;
+        file.open(path, std::ios::binary);
+        file << (hasTimestamps ? "row,game_time_ms,prob_blue,prob_orange,reliability\n" : "id,prob_blue,prob_orange\n");
+        return static_cast<bool>(file);
+    }
+
+    bool IsOpen() const { return file.is_open(); }
+
+    void Write(const int64_t* ids, const double* timesMs, const std::vector<Prediction>& predictions) {
+        text.clear();
+        for (size_t i = 0; i < predictions.size(); i++) {
+            AppendCsvNumber(text, ids[i]);
+            text += ',';
+            if (hasTimestamps) {
+                AppendCsvNumber(text, timesMs[i]);
+                text += ',';
+            }
+            AppendCsvNumber(text, predictions[i].prob_blue);
+            text += ',';
+            AppendCsvNumber(text, predictions[i].prob_orange);
+            if (hasTimestamps) {
+                text += ',';
+                AppendCsvNumber(text, static_cast<int>(predictions[i].reliability));
+            }
+            text += '\n';
+        }
+        file.write(text.data(), text.size());
+    }
+};
@@ -0,0 +1,130 @@
+#include "RowSource.h"
+#include "KaggleCsvParser.h"
+#include "MappedFile.h"
+#include "../LogSink.h"
+#include "../SnapshotFormat.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+// Yields the SNAPSHOT_INPUT records of a snapshot file, skipping everything else.
+class SnapshotRowSource : public RowSource {
+private:
+    MappedFile file;
+    size_t position = 0;
+    int64_t numRows = 0;
+    bool failed = false;
+
+public:
+    bool Open(const std::filesystem::path& path) {
+        if (!file.Open(path)) {
+            LOG("Failed to open {}", path.string());
+            return false;
+        }
+        SnapshotFileHeader header;
+        if (file.GetSize() < sizeof(header)) {
+            LOG("{} is too short to be a snapshot file", path.string());
+            return false;
+        }
+        std::memcpy(&header, file.GetData(), sizeof(header));
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            LOG("{} is not a snapshot file", path.string());
+            return false;
+        }
+        if (header.version != SNAPSHOT_VERSION || header.inputDim != INPUT_DIM) {
+            LOG("{} has snapshot version {} with {} inputs, expected version {} with {}", path.string(), header.version,
+                header.inputDim, SNAPSHOT_VERSION, INPUT_DIM);
+            return false;
+        }
+        position = sizeof(header);
+        return true;
+    }
+
+    size_t Read(float* rows, int64_t* ids, double* timesMs, PredictionReliability* reliabilities, size_t maxRows) override {
+        size_t numRead = 0;
+        while (numRead < maxRows && position < file.GetSize() && !failed) {
+            SnapshotRecordHeader header = {};
+            size_t remaining = file.GetSize() - position;
+            if (remaining >= sizeof(header)) {
+                std::memcpy(&header, file.GetData() + position, sizeof(header));
+            }
+            if (remaining < sizeof(header) || remaining - sizeof(header) < header.size) {
+                // A recording cut off mid-record, e.g. by the game crashing, is still worth replaying up to there
+                LOG("Snapshot file ends with a partial record at byte {}, ignoring it", position);
+                position = file.GetSize();
+                break;
+            }
+            size_t recordPosition = position;
+            const char* payload = file.GetData() + position + sizeof(header);
+            position += sizeof(header) + header.size;
+
+            if (header.type != SNAPSHOT_INPUT) {
+                continue;
+            }
+            uint32_t reliability = 0;
+            if (header.size == sizeof(SnapshotInputRecord)) {
+                std::memcpy(&reliability, payload + offsetof(SnapshotInputRecord, reliability), sizeof(reliability));
+            }
+            if (header.size != sizeof(SnapshotInputRecord) || reliability > UNRELIABLE_NEAR_ZERO_SECONDS) {
+                LOG("Bad snapshot input record at byte {}: {} bytes with reliability {}, expected {} bytes",
+                    recordPosition, header.size, reliability, sizeof(SnapshotInputRecord));
+                // The rows before it in this batch are still good, but nothing after it is read
+                failed = true;
+                break;
+            }
+            std::memcpy(rows + numRead * INPUT_DIM, payload + offsetof(SnapshotInputRecord, inputs), INPUT_DIM * sizeof(float));
+            ids[numRead] = numRows++;
+            timesMs[numRead] = header.gameTimeMs;
+            reliabilities[numRead] = static_cast<PredictionReliability>(reliability);
+            numRead++;
+        }
+        return numRead;
+    }
+
+    bool HasTimestamps() const override { return true; }
+    bool HasFailed() const override { return failed; }
+    size_t GetNumBytesRead() const override { return position; }
+    size_t GetSizeBytes() const override { return file.GetSize(); }
+};
+
+// Kaggle test set format CSV, see KaggleCsvParser.
+class CsvRowSource : public RowSource {
+private:
+    MappedFile file;
+    KaggleCsvParser parser;
+
+public:
+    bool Open(const std::filesystem::path& path) {
+        if (!file.Open(path)) {
+            LOG("Failed to open {}", path.string());
+            return false;
+        }
+        return parser.Begin(file.GetData(), file.GetSize());
+    }
+
+    size_t Read(float* rows, int64_t* ids, double* timesMs, PredictionReliability* reliabilities, size_t maxRows) override {
+        size_t numRead = parser.Parse(rows, ids, maxRows);
+        std::fill_n(timesMs, numRead, std::numeric_limits<double>::quiet_NaN());
+        std::fill_n(reliabilities, numRead, RELIABLE);
+        return numRead;
+    }
+
+    bool HasTimestamps() const override { return false; }
+    bool HasFailed() const override { return parser.HasFailed(); }
+    size_t GetNumBytesRead() const override { return parser.GetNumBytesParsed(); }
+    size_t GetSizeBytes() const override { return file.GetSize(); }
+};
+
+std::unique_ptr<RowSource> OpenRowSource(const std::filesystem::path& path) {
+    if (path.extension() == SNAPSHOT_FILE_EXTENSION) {
+        auto source = std::make_unique<SnapshotRowSource>();
+        return source->Open(path) ? std::move(source) : nullptr;
+    }
+    if (path.extension() == ".csv") {
+        auto source = std::make_unique<CsvRowSource>();
+        return source->Open(path) ? std::move(source) : nullptr;
+    }
+    LOG("Unknown input type {}, expected a {} or .csv file", path.string(), SNAPSHOT_FILE_EXTENSION);
+    return nullptr;
+}
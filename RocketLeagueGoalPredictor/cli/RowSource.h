@@ -0,0 +1,30 @@
+#pragma once
+#include "../GameEvents.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// Streams model input rows (INPUT_DIM floats each, NaN where unknown) from a memory mapped recording.
+class RowSource {
+public:
+    virtual ~RowSource() = default;
+
+    // Copies up to maxRows more rows to consecutive INPUT_DIM blocks of rows, along with each row's id (the CSV id
+    // column, or its index in the file), timestamp and reliability (RELIABLE where it isn't recorded). Returns the
+    // number of rows read, which are still valid if reading stopped at an error, then 0 once the input is used up or
+    // after an error.
+    virtual size_t Read(float* rows, int64_t* ids, double* timesMs, PredictionReliability* reliabilities, size_t maxRows) = 0;
+
+    // Whether the rows have recorded game times, otherwise timesMs is left as NaN.
+    virtual bool HasTimestamps() const = 0;
+    // Whether reading stopped early because the input was malformed. The reason has been logged.
+    virtual bool HasFailed() const = 0;
+
+    virtual size_t GetNumBytesRead() const = 0;
+    virtual size_t GetSizeBytes() const = 0;
+};
+
+// Opens a snapshot recording (SNAPSHOT_FILE_EXTENSION) or a Kaggle format CSV, chosen by file extension. Returns null
+// and logs why if it can't be read.
+std::unique_ptr<RowSource> OpenRowSource(const std::filesystem::path& path);
@@ -0,0 +1,52 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+
+// Helpers shared by the micro benchmarks in this directory. Benchmarks print their timings rather than asserting on
+// them; with --quick they run a small fraction of the work, so ctest can smoke test them on every build.
+
+struct BenchOptions {
+    bool quick = false;
+    int numTrials = 5;
+};
+
+inline BenchOptions ParseBenchOptions(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view(argv[i]) == "--quick") {
+            options.quick = true;
+            options.numTrials = 1;
+        }
+    }
+    return options;
+}
+
+// Keeps the compiler from optimizing away a benchmarked result.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+// Calls fn numCalls times per trial, and returns nanoseconds per call in the fastest trial, which is the one least
+// disturbed by anything else running on the machine. The work per trial is cut 100x with --quick.
+template <typename Fn>
+double MeasureNsPerCall(const BenchOptions& options, size_t numCalls, Fn&& fn) {
+    numCalls = options.quick ? std::max<size_t>(numCalls / 100, 1) : numCalls;
+    double bestNs = 0;
+    for (int trial = 0; trial < options.numTrials; trial++) {
+        auto startTime = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < numCalls; i++) {
+            fn(i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / numCalls;
+        bestNs = trial == 0 ? ns : std::min(bestNs, ns);
+    }
+    return bestNs;
+}
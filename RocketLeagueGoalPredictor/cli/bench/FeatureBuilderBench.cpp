@@ -0,0 +1,57 @@
+#include "BenchUtil.h"
+#include "../../FeatureBuilder.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Times BuildFeatures(), the per-prediction step which turns a captured GameSnapshot into the model's input columns,
+// on random snapshots with the odd demolished car and running respawn timers.
+//
+//   feature_builder_bench [--quick]
+
+static const size_t NUM_SNAPSHOTS = 1024; // Power of 2, cycled through so the inputs don't stay in registers
+static const size_t NUM_CALLS = 2'000'000;
+
+static std::vector<GameSnapshot> MakeRandomSnapshots(std::mt19937& rng) {
+    std::uniform_real_distribution<float> position(-4000, 4000);
+    std::uniform_real_distribution<float> velocity(-2300, 2300);
+    std::uniform_real_distribution<float> angularVelocity(-330, 330);
+    std::uniform_int_distribution<int32_t> pitch(-16384, 16384);
+    std::uniform_int_distribution<int32_t> angle(-32768, 32767);
+    std::uniform_real_distribution<float> unit(0, 1);
+    auto randomVec = [&](auto& distribution) { return Vec3f{ distribution(rng), distribution(rng), distribution(rng) }; };
+    auto randomRigidBody = [&] { return RigidBodySnapshot{ randomVec(position), randomVec(velocity), randomVec(angularVelocity) }; };
+
+    std::vector<GameSnapshot> snapshots(NUM_SNAPSHOTS);
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        auto& snapshot = snapshots[i];
+        snapshot.timeMs = 60'000 + i * 33.0;
+        snapshot.ball = randomRigidBody();
+        for (auto& car : snapshot.cars) {
+            car = { unit(rng) < 0.05f, randomRigidBody(), { pitch(rng), angle(rng), angle(rng) }, unit(rng) };
+        }
+        snapshot.secondsRemaining = static_cast<int>(unit(rng) * 300);
+        snapshot.overtime = false;
+    }
+    return snapshots;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = ParseBenchOptions(argc, argv);
+    std::mt19937 rng(1);
+    auto snapshots = MakeRandomSnapshots(rng);
+
+    RespawnTimers respawnTimers;
+    for (int i = 0; i < 6; i += 2) {
+        respawnTimers.OnBigBoostPickup(snapshots[NUM_SNAPSHOTS / 2].timeMs, i);
+        respawnTimers.OnDemolition(snapshots[NUM_SNAPSHOTS / 2].timeMs, i);
+    }
+
+    FeatureVector features;
+    double ns = MeasureNsPerCall(options, NUM_CALLS, [&](size_t i) {
+        BuildFeatures(snapshots[i % NUM_SNAPSHOTS], respawnTimers, features);
+        DoNotOptimize(features);
+    });
+    std::printf("BuildFeatures: %.1f ns per snapshot\n", ns);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "BenchUtil.h"
+#include "../KaggleCsvParser.h"
+#include "../../FeatureBuilder.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Read-only throughput of KaggleCsvParser, without inference or output: parses an in-memory CSV shaped like the Kaggle
+// test set (an id, then columns of 2 to 4 decimal places with the odd missing value) in batches of 512 rows, as
+// goal_predictor_cli --read-only does, and reports MB/s and rows/s.
+//
+//   kaggle_csv_parser_bench [--quick]
+
+static const size_t NUM_ROWS = 20'000;
+static const size_t BATCH_ROWS = 512;
+
+static std::string MakeCsv(size_t numRows) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> position(-5'000, 5'000);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::string csv = "id";
+    for (int column = 0; column < INPUT_DIM; column++) {
+        csv += ",c" + std::to_string(column);
+    }
+    csv += '\n';
+
+    char text[32];
+    for (size_t row = 0; row < numRows; row++) {
+        csv += std::to_string(row);
+        for (int column = 0; column < INPUT_DIM; column++) {
+            csv += ',';
+            if (unit(rng) < 0.02) {
+                continue;
+            }
+            std::snprintf(text, sizeof(text), "%.*f", 2 + column % 3, position(rng));
+            csv += text;
+        }
+        csv += '\n';
+    }
+    return csv;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = ParseBenchOptions(argc, argv);
+    std::string csv = MakeCsv(options.quick ? NUM_ROWS / 100 : NUM_ROWS);
+
+    std::vector<float> rows(BATCH_ROWS * INPUT_DIM);
+    std::vector<int64_t> ids(BATCH_ROWS);
+    size_t numRows = 0;
+    double ns = MeasureNsPerCall(options, 1, [&](size_t) {
+        KaggleCsvParser parser;
+        parser.Begin(csv.data(), csv.size());
+        numRows = 0;
+        while (size_t numParsed = parser.Parse(rows.data(), ids.data(), BATCH_ROWS)) {
+            numRows += numParsed;
+        }
+        DoNotOptimize(rows.data());
+    });
+
+    std::printf("%zu rows, %.1f MB: %.1f ms, %.0f MB/s, %.0f rows/s\n", numRows, csv.size() / 1e6, ns / 1e6,
+        csv.size() / 1e6 / (ns / 1e9), numRows / (ns / 1e9));
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "BenchUtil.h"
+#include "../../PredictionLines.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Compares the two ways the graph has drawn its prediction lines, on a headless ImGui context with the same style
+// settings as in game (anti-aliased lines): AddLine() for every pair of neighbouring predictions, reproduced here, and
+// one AddPolyline() per continuous run, by calling the plugin's own DrawPredictionLines(). Both draw the same screen
+// space points. Reports the vertices and indices each frame adds to the draw list, and the CPU time to build them.
+//
+//   prediction_lines_bench [--quick]
+
+static const ImU32 COL_BLUE = IM_COL32(60, 120, 255, 255);
+static const ImU32 COL_ORANGE = IM_COL32(255, 150, 60, 255);
+static const ImU32 COL_WHITE = IM_COL32(255, 255, 255, 255);
+static const ImU32 COL_YELLOW = IM_COL32(255, 255, 0, 255);
+
+static const float GRAPH_WIDTH = 1200;
+static const float GRAPH_HEIGHT = 300;
+static const double PREDICTION_INTERVAL_MS = 30;
+static const double MAX_GAP_MS = 100; // MAX_PREDICTION_LINE_TIME_GAP_MS
+static const size_t NUM_FRAMES = 2'000;
+
+// A random walk of predictions at the full rate, with the odd gap and short unreliable stretches, spread over the graph
+static PredictionLinePoints MakePoints(size_t numPoints, std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::normal_distribution<float> step(0, 0.02f);
+    PredictionLinePoints points;
+    double timeMs = 0;
+    float blue = 0.3f;
+    float orange = 0.3f;
+    bool reliable = true;
+    for (size_t i = 0; i < numPoints; i++) {
+        timeMs += unit(rng) < 0.005f ? 500 : PREDICTION_INTERVAL_MS;
+        blue = std::clamp(blue + step(rng), 0.0f, 1.0f);
+        orange = std::clamp(orange + step(rng), 0.0f, 1.0f - blue);
+        if (unit(rng) < 0.01f) {
+            reliable = !reliable;
+        }
+        points.timesMs.push_back(timeMs);
+        points.blue.emplace_back(0.0f, GRAPH_HEIGHT / 2 * (1 - blue));
+        points.orange.emplace_back(0.0f, GRAPH_HEIGHT / 2 * (1 + orange));
+        points.delta.emplace_back(0.0f, GRAPH_HEIGHT / 2 * (1 - (blue - orange)));
+        points.deltaColors.push_back(reliable ? COL_WHITE : COL_YELLOW);
+    }
+    for (size_t i = 0; i < numPoints; i++) {
+        float x = static_cast<float>(points.timesMs[i] / timeMs * GRAPH_WIDTH);
+        points.blue[i].x = points.orange[i].x = points.delta[i].x = x;
+    }
+    return points;
+}
+
+// The previous approach: three AddLine() calls per pair of neighbouring predictions
+static void DrawWithLines(ImDrawList* dl, const PredictionLinePoints& points) {
+    for (size_t i = 1; i < points.timesMs.size(); i++) {
+        if (points.timesMs[i] - points.timesMs[i - 1] >= MAX_GAP_MS) {
+            continue;
+        }
+        dl->AddLine(points.blue[i - 1], points.blue[i], COL_BLUE, 1.0f);
+        dl->AddLine(points.orange[i - 1], points.orange[i], COL_ORANGE, 1.0f);
+        dl->AddLine(points.delta[i - 1], points.delta[i], points.deltaColors[i], 4.0f);
+    }
+}
+
+static void DrawWithPolylines(ImDrawList* dl, const PredictionLinePoints& points) {
+    DrawPredictionLines(dl, points, MAX_GAP_MS, COL_BLUE, COL_ORANGE);
+}
+
+template <typename DrawFn>
+static void Measure(const BenchOptions& options, const char* name, const PredictionLinePoints& points, DrawFn&& draw) {
+    ImDrawList dl(ImGui::GetDrawListSharedData());
+    auto startFrame = [&] {
+        dl.Clear();
+        dl.PushClipRectFullScreen();
+        dl.PushTextureID(ImGui::GetIO().Fonts->TexID);
+    };
+    double ns = MeasureNsPerCall(options, NUM_FRAMES, [&](size_t) {
+        startFrame();
+        draw(&dl, points);
+        DoNotOptimize(dl.VtxBuffer.Data);
+    });
+    std::printf("  %-12s %7d vertices %7d indices %8.1f us per frame\n", name, dl.VtxBuffer.Size, dl.IdxBuffer.Size, ns / 1000);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = ParseBenchOptions(argc, argv);
+
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1920, 1080);
+    io.IniFilename = nullptr; // Nothing to save between runs
+    unsigned char* pixels;
+    int width;
+    int height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    ImGui::NewFrame();
+
+    std::mt19937 rng(1);
+    // Up to ~4 per pixel, beyond which DrawPredictions() switches to the pyramid's summaries
+    for (float predictionsPerPixel : { 1.0f, 4.0f }) {
+        auto points = MakePoints(static_cast<size_t>(GRAPH_WIDTH * predictionsPerPixel), rng);
+        std::printf("%zu predictions over %.0f pixels:\n", points.timesMs.size(), GRAPH_WIDTH);
+        Measure(options, "AddLine", points, DrawWithLines);
+        Measure(options, "AddPolyline", points, DrawWithPolylines);
+    }
+
+    ImGui::EndFrame();
+    ImGui::DestroyContext();
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "BenchUtil.h"
+#include "../../RotationMath.h"
+#include <array>
+#include <cstdio>
+#include <random>
+#include <tuple>
+#include <vector>
+
+// Times converting rotators to basis vectors with the scalar RotatorToRotAndUpVectors() against the batched
+// RotatorsToRotAndUpVectors(), in both the shapes they're used in: the 6 cars of one snapshot, as BuildFeatures() does
+// on every live prediction, and the cars of thousands of snapshots at once, as an offline run over a recording can.
+//
+//   rotation_math_bench [--quick]
+
+static const size_t NUM_CARS = 6;
+static const size_t NUM_SNAPSHOTS = 4096; // Power of 2, cycled through so the inputs don't stay in registers
+static const size_t NUM_CALLS = 2'000'000;
+static const size_t NUM_LARGE_BATCH_CALLS = 500; // Each over all NUM_SNAPSHOTS
+
+int main(int argc, char** argv) {
+    BenchOptions options = ParseBenchOptions(argc, argv);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int32_t> pitch(-16384, 16384);
+    std::uniform_int_distribution<int32_t> angle(-32768, 32767);
+    std::vector<Rotator3i> rotators(NUM_SNAPSHOTS * NUM_CARS);
+    for (auto& rotator : rotators) {
+        rotator = { pitch(rng), angle(rng), angle(rng) };
+    }
+
+    std::array<Vec3f, NUM_CARS> rots;
+    std::array<Vec3f, NUM_CARS> ups;
+    double scalarNs = MeasureNsPerCall(options, NUM_CALLS, [&](size_t i) {
+        const Rotator3i* snapshotRotators = &rotators[(i % NUM_SNAPSHOTS) * NUM_CARS];
+        for (size_t car = 0; car < NUM_CARS; car++) {
+            std::tie(rots[car], ups[car]) = RotatorToRotAndUpVectors(snapshotRotators[car]);
+        }
+        DoNotOptimize(rots);
+        DoNotOptimize(ups);
+    });
+    double batchedNs = MeasureNsPerCall(options, NUM_CALLS, [&](size_t i) {
+        RotatorsToRotAndUpVectors(&rotators[(i % NUM_SNAPSHOTS) * NUM_CARS], NUM_CARS, rots.data(), ups.data());
+        DoNotOptimize(rots);
+        DoNotOptimize(ups);
+    });
+
+
+    std::vector<Vec3f> allRots(rotators.size());
+    std::vector<Vec3f> allUps(rotators.size());
+    double largeScalarNs = MeasureNsPerCall(options, NUM_LARGE_BATCH_CALLS, [&](size_t) {
+        for (size_t i = 0; i < rotators.size(); i++) {
+            std::tie(allRots[i], allUps[i]) = RotatorToRotAndUpVectors(rotators[i]);
+        }
+        DoNotOptimize(allRots.data());
+        DoNotOptimize(allUps.data());
+    });
+    double largeBatchedNs = MeasureNsPerCall(options, NUM_LARGE_BATCH_CALLS, [&](size_t) {
+        RotatorsToRotAndUpVectors(rotators.data(), rotators.size(), allRots.data(), allUps.data());
+        DoNotOptimize(allRots.data());
+        DoNotOptimize(allUps.data());
+    });
+
+    std::printf("6 cars, scalar:  %.1f ns per snapshot\n", scalarNs);
+    std::printf("6 cars, batched: %.1f ns per snapshot\n", batchedNs);
+    std::printf("%zu snapshots of 6 cars, scalar:  %.1f ns per snapshot\n", NUM_SNAPSHOTS, largeScalarNs / NUM_SNAPSHOTS);
+    std::printf("%zu snapshots of 6 cars, batched: %.1f ns per snapshot\n", NUM_SNAPSHOTS, largeBatchedNs / NUM_SNAPSHOTS);
+    return 0;
+}
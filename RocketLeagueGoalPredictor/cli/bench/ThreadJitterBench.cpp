@@ -0,0 +1,103 @@
+#include "BenchUtil.h"
+#include "../../LatencyHistogram.h"
+#include "../../ThreadQoS.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Measures how much busy inference lanes delay the game thread under each ThreadQoS setting. A stand-in game thread
+// does ~2ms of work every 16.6ms frame while one spinning lane per logical core competes with it, and the time from
+// each frame's scheduled start to the end of its work is recorded. Without contention that's just the work itself.
+//
+//   thread_jitter_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+static const auto FRAME_PERIOD = std::chrono::microseconds(16'667);
+static const auto FRAME_WORK = std::chrono::microseconds(2'000);
+static const int NUM_FRAMES = 300;
+
+static uint64_t Spin(uint64_t numIterations) {
+    uint64_t x = 1;
+    for (uint64_t i = 0; i < numIterations; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        DoNotOptimize(x);
+    }
+    return x;
+}
+
+// Iterations of Spin() which take FRAME_WORK on an idle machine
+static uint64_t CalibrateFrameWork() {
+    const uint64_t numIterations = 1'000'000;
+    auto best = Clock::duration::max();
+    for (int trial = 0; trial < 5; trial++) {
+        auto startTime = Clock::now();
+        Spin(numIterations);
+        best = std::min(best, Clock::now() - startTime);
+    }
+    return std::max<uint64_t>(numIterations * FRAME_WORK.count() / std::chrono::duration_cast<std::chrono::microseconds>(best).count(), 1);
+}
+
+static void RunFrames(int numFrames, uint64_t workIterations, LatencyHistogram& histogram) {
+    auto frameStart = Clock::now() + FRAME_PERIOD;
+    for (int frame = 0; frame < numFrames; frame++, frameStart += FRAME_PERIOD) {
+        std::this_thread::sleep_until(frameStart);
+        Spin(workIterations);
+        histogram.Record(Clock::now() - frameStart);
+    }
+}
+
+// Runs the frames with a spinning lane per logical core, or with none if qos is null
+static void MeasureFrames(const char* name, const ThreadQoS* qos, int numFrames, uint64_t workIterations) {
+    std::atomic<bool> stopping = false;
+    std::atomic<int> numStarted = 0;
+    std::atomic<bool> qosFailed = false;
+    std::vector<std::thread> lanes;
+    int numLanes = qos ? std::max(1u, std::thread::hardware_concurrency()) : 0;
+    for (int i = 0; i < numLanes; i++) {
+        lanes.emplace_back([&] {
+            if (!ApplyThreadQoS(*qos)) {
+                qosFailed = true;
+            }
+            numStarted++;
+            while (!stopping.load(std::memory_order_relaxed)) {
+                Spin(10'000);
+            }
+        });
+    }
+    while (numStarted < numLanes) {
+        std::this_thread::yield();
+    }
+
+    LatencyHistogram histogram;
+    RunFrames(numFrames, workIterations, histogram);
+    stopping = true;
+    for (auto& lane : lanes) {
+        lane.join();
+    }
+
+    std::printf("%-22s p50 %6.2f ms  p99 %6.2f ms  max %6.2f ms%s\n", name, histogram.GetPercentileMs(0.5),
+        histogram.GetPercentileMs(0.99), histogram.GetMaxMs(), qosFailed ? "  (QoS not fully applied)" : "");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = ParseBenchOptions(argc, argv);
+    int numFrames = options.quick ? 20 : NUM_FRAMES;
+    uint64_t workIterations = CalibrateFrameWork();
+
+    std::printf("Game frame: %.1f ms of work every %.1f ms, against %u spinning lanes\n",
+        FRAME_WORK.count() / 1000.0, FRAME_PERIOD.count() / 1000.0, std::max(1u, std::thread::hardware_concurrency()));
+    int numLastCores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 4);
+    ThreadQoS none{ 0, false };
+    ThreadQoS lowPriority{ 0, true };
+    ThreadQoS lastCores{ numLastCores, false };
+    ThreadQoS both{ numLastCores, true };
+    MeasureFrames("no lanes", nullptr, numFrames, workIterations);
+    MeasureFrames("lanes, default", &none, numFrames, workIterations);
+    MeasureFrames("lanes, low priority", &lowPriority, numFrames, workIterations);
+    MeasureFrames("lanes, last cores", &lastCores, numFrames, workIterations);
+    MeasureFrames("lanes, both", &both, numFrames, workIterations);
+    return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+// Stands in for the plugin's precompiled header, which the vendored ImGui sources include first, for the headless
+// ImGui build in CMakeLists.txt. Only ImGui itself is needed, not the BakkesMod SDK.
+#include "imgui.h"
@@ -0,0 +1,444 @@
+#include "AlignedAllocator.h"
+#include "ConsoleLog.h"
+#include "OfflinePipeline.h"
+#include "PredictionWriter.h"
+#include "RowSource.h"
+#include "../InferenceEngine.h"
+#include "../InferencePool.h"
+#include "../LatencyHistogram.h"
+#include "../LogSink.h"
+#include "../PredictionRateController.h"
+#include "../SnapshotFormat.h"
+#include "../Tracer.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Headless replay of recorded model inputs through the plugin's InferenceEngine, without BakkesMod or ImGui, to
+// compare models and settings offline. Reads a snapshot recording or a Kaggle format CSV, and writes the predictions
+// plus per-batch stage timings.
+//
+// Throughput mode reads as fast as the inference lanes can keep up. Paced mode releases each batch when its last row
+// would have arrived live, following the recorded game times or a fixed rate, and skips batches when every lane is
+// backed up just like the plugin does, so the latencies match what players would see.
+//
+// Pipeline mode splits reading, tensor building, inference and writing into stages spread over every core, for
+// scoring large files as fast as possible (see OfflinePipeline.h).
+
+static const size_t DEFAULT_BATCH_SIZE = 64;
+static const size_t DEFAULT_PIPELINE_BATCH_SIZE = 256;
+// Batches queued or running per lane before the reader waits, bounding memory use on huge inputs
+static const size_t MAX_BATCHES_IN_FLIGHT_PER_LANE = 4;
+// Longest gap between recorded rows reproduced in paced mode, so pauses and session breaks don't stall the replay
+static const double MAX_PACED_GAP_MS = 1000;
+static const char PROFILE_OUTPUT_PREFIX[] = "goal_predictor_cli_profile";
+static const size_t CACHE_LINE_BYTES = 64;
+
+struct Options {
+    std::filesystem::path modelPath;
+    std::filesystem::path inputPath;
+    std::filesystem::path outputPath; // Predictions, skipped if empty
+    std::filesystem::path timingsPath; // Per-batch timings, skipped if empty
+    std::filesystem::path tracePath; // Chrome trace, skipped if empty
+    Augmentation augmentation = NO_AUGMENT;
+    size_t batchSize = 0; // 0 for the default, which depends on the mode
+    int numThreads = 0; // 0 for the default, which depends on the mode
+    bool paced = false;
+    bool pipeline = false;
+    double rateHz = 0; // Fixed paced rate, or 0 to follow the recorded game times where there are any
+    int profileRuns = 0;
+    bool readOnly = false; // Only read the input, to measure the reader on its own
+};
+
+// One batch of rows on its way through the lanes. Only the lane running it touches it until done is set.
+struct Batch {
+    size_t index = 0;
+    size_t numRows = 0;
+    std::vector<float, AlignedAllocator<float, CACHE_LINE_BYTES>> rows;
+    std::vector<int64_t> ids;
+    std::vector<double> timesMs;
+    std::vector<PredictionReliability> reliabilities;
+    std::vector<Prediction> predictions;
+    bool succeeded = false;
+    bool done = false;
+
+    std::chrono::steady_clock::time_point readyTime; // When it was read, or when it was due in paced mode
+    int lane = -1;
+    double readMs = 0;
+    double queueWaitMs = 0;
+    double predictMs = 0;
+    double latencyMs = 0;
+};
+
+static void PrintUsage() {
+    std::fprintf(stderr,
+        "Usage: goal_predictor_cli --model model.onnx --input recording%s|test.csv [options]\n"
+        "  --output FILE     Write predictions as CSV\n"
+        "  --timings FILE    Write per-batch stage timings as CSV\n"
+        "  --augment 1|2|4   Augmentation, as in the plugin (default 1)\n"
+        "  --batch N         Rows per session run (default %zu, 1 when paced or %zu with --pipeline)\n"
+        "  --threads N       Inference lanes, or pipeline workers (default 1, or every core with --pipeline)\n"
+        "  --paced           Release rows at their live cadence instead of as fast as possible\n"
+        "  --rate HZ         Paced rate, instead of following recorded game times (default %.0f for CSV input)\n"
+        "  --profile N       Profile the first N session runs with ONNX Runtime\n"
+        "  --trace FILE      Write a Chrome trace of the run\n"
+        "  --read-only       Only read the input, without a model, to measure the reader's throughput\n"
+        "  --pipeline        Score the input with parallel read, build, infer and write stages, for bulk throughput\n",
+        SNAPSHOT_FILE_EXTENSION, DEFAULT_BATCH_SIZE, DEFAULT_PIPELINE_BATCH_SIZE, 1000 / MIN_PREDICTION_INTERVAL_MS);
+}
+
+template <typename T>
+static bool ParseNumber(std::string_view text, T& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--paced" || arg == "--read-only" || arg == "--pipeline") {
+            (arg == "--paced" ? options.paced : arg == "--read-only" ? options.readOnly : options.pipeline) = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return false;
+        }
+        std::string_view value = argv[++i];
+
+        bool valid = true;
+        int augmentation = 0;
+        if (arg == "--model") {
+            options.modelPath = value;
+        }
+        else if (arg == "--input") {
+            options.inputPath = value;
+        }
+        else if (arg == "--output") {
+            options.outputPath = value;
+        }
+        else if (arg == "--timings") {
+            options.timingsPath = value;
+        }
+        else if (arg == "--trace") {
+            options.tracePath = value;
+        }
+        else if (arg == "--augment") {
+            valid = ParseNumber(value, augmentation) && (augmentation == NO_AUGMENT || augmentation == AUGMENT_2X || augmentation == AUGMENT_4X);
+            options.augmentation = static_cast<Augmentation>(augmentation);
+        }
+        else if (arg == "--batch") {
+            valid = ParseNumber(value, options.batchSize) && options.batchSize > 0;
+        }
+        else if (arg == "--threads") {
+            valid = ParseNumber(value, options.numThreads) && options.numThreads > 0;
+        }
+        else if (arg == "--rate") {
+            valid = ParseNumber(value, options.rateHz) && options.rateHz > 0;
+        }
+        else if (arg == "--profile") {
+            valid = ParseNumber(value, options.profileRuns) && options.profileRuns > 0;
+        }
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i - 1]);
+            return false;
+        }
+        if (!valid) {
+            std::fprintf(stderr, "Invalid value for %s: %s\n", argv[i - 1], argv[i]);
+            return false;
+        }
+    }
+
+    if ((options.modelPath.empty() && !options.readOnly) || options.inputPath.empty()) {
+        std::fprintf(stderr, "--model and --input are required\n");
+        return false;
+    }
+    if (options.pipeline && (options.paced || options.readOnly || !options.timingsPath.empty())) {
+        std::fprintf(stderr, "--pipeline can't be combined with --paced, --read-only or --timings\n");
+        return false;
+    }
+    if (options.batchSize == 0) {
+        options.batchSize = options.paced ? 1 : options.pipeline ? DEFAULT_PIPELINE_BATCH_SIZE : DEFAULT_BATCH_SIZE;
+    }
+    if (options.numThreads == 0) {
+        options.numThreads = options.pipeline ? std::max(static_cast<int>(std::thread::hardware_concurrency()), 1) : 1;
+    }
+    return true;
+}
+
+static double MillisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static void WriteTimings(std::ofstream& file, const Batch& batch, std::string& text) {
+    text.clear();
+    AppendCsvNumber(text, batch.index);
+    text += ',';
+    AppendCsvNumber(text, batch.ids[0]);
+    text += ',';
+    AppendCsvNumber(text, batch.numRows);
+    text += ',';
+    AppendCsvNumber(text, batch.lane);
+    for (double ms : { batch.readMs, batch.queueWaitMs, batch.predictMs,
+            batch.predictions.empty() ? 0.0 : batch.predictions[0].prediction_time_ms, batch.latencyMs }) {
+        text += ',';
+        AppendCsvNumber(text, ms);
+    }
+    text += '\n';
+    file.write(text.data(), text.size());
+}
+
+static void PrintStage(const char* name, const LatencyHistogram& histogram) {
+    std::printf("%-14s %10llu %9.3f %9.3f %9.3f %9.3f\n", name, static_cast<unsigned long long>(histogram.GetCount()),
+        histogram.GetPercentileMs(0.5), histogram.GetPercentileMs(0.9), histogram.GetPercentileMs(0.99), histogram.GetMaxMs());
+}
+
+static int RunReadOnly(RowSource& source, size_t batchSize) {
+    std::vector<float, AlignedAllocator<float, CACHE_LINE_BYTES>> rows(batchSize * INPUT_DIM);
+    std::vector<int64_t> ids(batchSize);
+    std::vector<double> timesMs(batchSize);
+    std::vector<PredictionReliability> reliabilities(batchSize);
+    size_t numRows = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    while (size_t numRead = source.Read(rows.data(), ids.data(), timesMs.data(), reliabilities.data(), batchSize)) {
+        numRows += numRead;
+    }
+    double elapsedSeconds = MillisecondsBetween(startTime, std::chrono::steady_clock::now()) / 1000;
+    FlushLogToStderr();
+
+    double megabytes = source.GetNumBytesRead() / 1e6;
+    std::printf("Read %zu rows, %.1f MB in %.3f s: %.0f rows/s, %.1f MB/s\n", numRows, megabytes, elapsedSeconds,
+        numRows / elapsedSeconds, megabytes / elapsedSeconds);
+    return source.HasFailed() ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+    SetTraceThreadName("Reader");
+    SetTracingEnabled(!options.tracePath.empty());
+
+    // The pipeline opens the input itself, to split it between workers
+    std::unique_ptr<RowSource> source;
+    if (!options.pipeline) {
+        source = OpenRowSource(options.inputPath);
+        if (source && options.readOnly) {
+            return RunReadOnly(*source, options.batchSize);
+        }
+    }
+    InferenceEngine engine;
+    bool loaded = (source || options.pipeline) && engine.Initialize(options.modelPath.string());
+    FlushLogToStderr();
+    if (!loaded) {
+        return 1;
+    }
+    std::printf("Model %s on %s\n", options.modelPath.string().c_str(), engine.GetBackendName().c_str());
+    if (options.profileRuns > 0 && !engine.StartProfiling(options.profileRuns, PROFILE_OUTPUT_PREFIX)) {
+        std::fprintf(stderr, "Failed to start profiling\n");
+    }
+    // Initialize() makes a test run, which shouldn't count
+    for (auto& histogram : GetPipelineHistograms()) {
+        histogram.Reset();
+    }
+
+    if (options.pipeline) {
+        bool succeeded = RunOfflinePipeline(options.inputPath, options.outputPath, engine,
+            { .augmentation = options.augmentation, .batchSize = options.batchSize, .numWorkers = options.numThreads });
+        if (!options.tracePath.empty()) {
+            WriteTraceJson(options.tracePath);
+        }
+        FlushLogToStderr();
+        return succeeded ? 0 : 1;
+    }
+
+    PredictionWriter predictionWriter;
+    bool predictionsOpened = options.outputPath.empty() || predictionWriter.Open(options.outputPath, source->HasTimestamps());
+    std::ofstream timingsFile;
+    if (!options.timingsPath.empty()) {
+        timingsFile.open(options.timingsPath, std::ios::binary);
+        timingsFile << "batch,first_id,rows,lane,read_ms,queue_wait_ms,predict_ms,session_run_ms,latency_ms\n";
+    }
+    if (!predictionsOpened || (!options.timingsPath.empty() && !timingsFile)) {
+        std::fprintf(stderr, "Failed to open output files\n");
+        return 1;
+    }
+
+    InferencePool pool;
+    pool.Start(options.numThreads, { .numLastCores = 0, .lowPriority = false });
+
+    std::mutex mutex;
+    std::condition_variable batchDone;
+    std::deque<std::unique_ptr<Batch>> inFlight; // In input order, so results are written in the same order
+    std::vector<std::unique_ptr<Batch>> freeBatches;
+    size_t maxInFlight = options.numThreads * MAX_BATCHES_IN_FLIGHT_PER_LANE;
+
+    LatencyHistogram readHistogram;
+    LatencyHistogram writeHistogram;
+    LatencyHistogram latencyHistogram;
+    size_t numRows = 0;
+    size_t numPredicted = 0;
+    size_t numBatches = 0;
+    size_t numFailedBatches = 0;
+    size_t numSkippedBatches = 0;
+    std::string text;
+
+    // Writes out finished batches from the front of the queue until at most maxRemaining are left in flight.
+    auto writeFinished = [&](size_t maxRemaining) {
+        while (true) {
+            std::unique_ptr<Batch> batch;
+            {
+                std::unique_lock lock(mutex);
+                batchDone.wait(lock, [&] { return inFlight.size() <= maxRemaining || inFlight.front()->done; });
+                if (inFlight.empty() || !inFlight.front()->done) {
+                    return;
+                }
+                batch = std::move(inFlight.front());
+                inFlight.pop_front();
+            }
+
+            ScopedTrace trace("Write");
+            auto writeStartTime = std::chrono::steady_clock::now();
+            latencyHistogram.Record(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(batch->latencyMs)));
+            numFailedBatches += !batch->succeeded;
+            numPredicted += batch->predictions.size();
+            if (predictionWriter.IsOpen()) {
+                predictionWriter.Write(batch->ids.data(), batch->timesMs.data(), batch->predictions);
+            }
+            if (timingsFile.is_open()) {
+                WriteTimings(timingsFile, *batch, text);
+            }
+            writeHistogram.Record(std::chrono::steady_clock::now() - writeStartTime);
+            freeBatches.push_back(std::move(batch));
+            FlushLogToStderr();
+        }
+    };
+
+    bool followRecordedTimes = source->HasTimestamps() && options.rateHz == 0;
+    double pacedIntervalMs = options.rateHz > 0 ? 1000 / options.rateHz : MIN_PREDICTION_INTERVAL_MS;
+    double dueOffsetMs = 0;
+    double lastRowTimeMs = std::numeric_limits<double>::quiet_NaN();
+
+    auto startTime = std::chrono::steady_clock::now();
+    while (true) {
+        writeFinished(maxInFlight - 1);
+
+        std::unique_ptr<Batch> batch;
+        if (freeBatches.empty()) {
+            batch = std::make_unique<Batch>();
+            batch->rows.resize(options.batchSize * INPUT_DIM);
+            batch->ids.resize(options.batchSize);
+            batch->timesMs.resize(options.batchSize);
+            batch->reliabilities.resize(options.batchSize);
+        }
+        else {
+            batch = std::move(freeBatches.back());
+            freeBatches.pop_back();
+        }
+
+        auto readStartTime = std::chrono::steady_clock::now();
+        {
+            ScopedTrace trace("Read");
+            batch->numRows = source->Read(batch->rows.data(), batch->ids.data(), batch->timesMs.data(), batch->reliabilities.data(),
+                options.batchSize);
+        }
+        auto readEndTime = std::chrono::steady_clock::now();
+        if (batch->numRows == 0) {
+            break;
+        }
+        readHistogram.Record(readEndTime - readStartTime);
+        batch->index = numBatches++;
+        batch->readMs = MillisecondsBetween(readStartTime, readEndTime);
+        batch->readyTime = readEndTime;
+        batch->done = false;
+        numRows += batch->numRows;
+
+        if (options.paced) {
+            for (size_t i = 0; i < batch->numRows; i++) {
+                if (!followRecordedTimes) {
+                    dueOffsetMs += pacedIntervalMs;
+                }
+                else if (!std::isnan(lastRowTimeMs)) {
+                    dueOffsetMs += std::clamp(batch->timesMs[i] - lastRowTimeMs, 0.0, MAX_PACED_GAP_MS);
+                }
+                lastRowTimeMs = batch->timesMs[i];
+            }
+            batch->readyTime = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(dueOffsetMs));
+            std::this_thread::sleep_until(batch->readyTime);
+
+            // If every inference lane is already backed up, the plugin would skip this prediction
+            if (pool.IsSaturated()) {
+                numSkippedBatches++;
+                freeBatches.push_back(std::move(batch));
+                continue;
+            }
+        }
+
+        Batch* job = batch.get();
+        {
+            std::lock_guard lock(mutex);
+            inFlight.push_back(std::move(batch));
+        }
+        pool.Submit([&, job](InferenceLane& lane) {
+            auto predictStartTime = std::chrono::steady_clock::now();
+            GetPipelineHistograms()[STAGE_QUEUE_WAIT].Record(predictStartTime - job->readyTime);
+            job->succeeded = engine.PredictBatch(job->rows.data(), job->reliabilities.data(), job->numRows, options.augmentation,
+                lane.buffers, job->predictions);
+            auto predictEndTime = std::chrono::steady_clock::now();
+            job->lane = lane.index;
+            job->queueWaitMs = MillisecondsBetween(job->readyTime, predictStartTime);
+            job->predictMs = MillisecondsBetween(predictStartTime, predictEndTime);
+            job->latencyMs = MillisecondsBetween(job->readyTime, predictEndTime);
+
+            std::lock_guard lock(mutex);
+            job->done = true;
+            batchDone.notify_all();
+        });
+    }
+    writeFinished(0);
+    pool.Stop();
+    double elapsedSeconds = MillisecondsBetween(startTime, std::chrono::steady_clock::now()) / 1000;
+
+    if (!options.tracePath.empty()) {
+        WriteTraceJson(options.tracePath);
+    }
+    FlushLogToStderr();
+
+    double megabytes = source->GetNumBytesRead() / 1e6;
+    std::printf("Predicted %zu of %zu rows in %zu batches of up to %zu, %dx augmentation, %d lane(s)%s\n", numPredicted,
+        numRows, numBatches, options.batchSize, static_cast<int>(options.augmentation), options.numThreads, options.paced ? ", paced" : "");
+    std::printf("%.3f s: %.0f rows/s, input %.1f MB at %.1f MB/s\n", elapsedSeconds, numPredicted / elapsedSeconds,
+        megabytes, megabytes / elapsedSeconds);
+    if (numSkippedBatches > 0) {
+        std::printf("%zu batches skipped because every lane was backed up\n", numSkippedBatches);
+    }
+    if (numFailedBatches > 0) {
+        std::printf("%zu batches failed\n", numFailedBatches);
+    }
+
+    std::printf("%-14s %10s %9s %9s %9s %9s\n", "stage (ms)", "count", "p50", "p90", "p99", "max");
+    PrintStage("read", readHistogram);
+    for (auto stage : { STAGE_QUEUE_WAIT, STAGE_TENSOR_BUILD, STAGE_SESSION_RUN }) {
+        PrintStage(GetPipelineStageName(stage), GetPipelineHistograms()[stage]);
+    }
+    PrintStage("write", writeHistogram);
+    PrintStage("latency", latencyHistogram);
+
+    return source->HasFailed() || numFailedBatches > 0 ? 1 : 0;
+}
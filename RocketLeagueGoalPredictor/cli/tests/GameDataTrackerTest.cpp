@@ -0,0 +1,220 @@
+#include "../../GameEvents.h"
+#include "../../GameDataTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+// Checks GameDataTracker::ForEachSkipping() against visiting every event in range: skipping to the next pixel column
+// must keep exactly the first event of each column, as the graph's ball hit lines do, for ranges starting and ending
+// anywhere relative to the events, including past either end of them.
+//
+// Checks that AddEvent() reports whether it inserted, which the respawn timers rely on to stay in step with the tracker.
+//
+// Then checks the Prediction pyramid against summaries built by brute force from the series itself, after random
+// adds, replacements and skips going back and forth in time as replays do, and that the work each AddEvent() does on
+// the pyramid stays bounded however long the series gets.
+
+static const int NUM_EVENTS = 5'000;
+static const int NUM_RANGES = 2'000;
+static const int NUM_PREDICTIONS = 20'000;
+static const int NUM_COUNTED_EVENTS = 50'000;
+
+// First event of each column over [minTimeMs, maxTimeMs], visiting them all
+static std::vector<double> FirstPerColumn(const GameDataTracker& tracker, double minTimeMs, double maxTimeMs, double columnMs) {
+    std::vector<double> times;
+    double lastColumn = -1;
+    for (auto const& [timeMs, event] : tracker.GetRangeInclusive<BallHitEvent>(minTimeMs, maxTimeMs)) {
+        double column = std::floor((timeMs - minTimeMs) / columnMs);
+        if (column != lastColumn) {
+            times.push_back(timeMs);
+            lastColumn = column;
+        }
+    }
+    return times;
+}
+
+static std::vector<double> FirstPerColumnSkipping(const GameDataTracker& tracker, double minTimeMs, double maxTimeMs, double columnMs) {
+    std::vector<double> times;
+    tracker.ForEachSkipping<BallHitEvent>(minTimeMs, maxTimeMs, [&](double timeMs, const BallHitEvent&) {
+        times.push_back(timeMs);
+        return minTimeMs + (std::floor((timeMs - minTimeMs) / columnMs) + 1) * columnMs;
+    });
+    return times;
+}
+
+static int CheckForEachSkipping(std::mt19937& rng) {
+    std::exponential_distribution<double> gapMs(1 / 150.0);
+    GameDataTracker tracker;
+    double timeMs = 0;
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        timeMs += gapMs(rng);
+        tracker.AddEvent(timeMs, BallHitEvent{ i % 2 == 0 }, { .overlapRadiusMs = 0 });
+    }
+
+    std::uniform_real_distribution<double> start(-10'000, timeMs + 10'000);
+    std::uniform_real_distribution<double> length(0, timeMs / 2);
+    std::uniform_real_distribution<double> columnMs(1, 2'000);
+    int numFailed = 0;
+    for (int i = 0; i < NUM_RANGES; i++) {
+        double minTimeMs = start(rng);
+        double maxTimeMs = minTimeMs + length(rng);
+        double column = columnMs(rng);
+        if (FirstPerColumnSkipping(tracker, minTimeMs, maxTimeMs, column) != FirstPerColumn(tracker, minTimeMs, maxTimeMs, column)) {
+            std::printf("FAILED: [%.1f, %.1f] with %.1f ms columns\n", minTimeMs, maxTimeMs, column);
+            numFailed++;
+        }
+    }
+    std::printf("%d ranges over %d events: %s\n", NUM_RANGES, NUM_EVENTS, numFailed == 0 ? "ok" : "FAILED");
+    return numFailed;
+}
+
+// Probabilities in 1/64ths, so sums are exact in any order and summaries can be compared exactly
+static Prediction MakePrediction(std::mt19937& rng) {
+    float blue = static_cast<float>(rng() % 65) / 64;
+    float orange = static_cast<float>(rng() % (65 - static_cast<int>(blue * 64))) / 64;
+    return Prediction(blue, orange, rng() % 4 == 0 ? UNRELIABLE_NEAR_ZERO_SECONDS : RELIABLE, NO_AUGMENT, 0);
+}
+
+static bool SameSummary(const Prediction::Summary& a, const Prediction::Summary& b) {
+    return a.min_blue == b.min_blue && a.max_blue == b.max_blue && a.sum_blue == b.sum_blue
+        && a.min_orange == b.min_orange && a.max_orange == b.max_orange && a.sum_orange == b.sum_orange
+        && a.min_delta == b.min_delta && a.max_delta == b.max_delta && a.sum_delta == b.sum_delta
+        && a.count == b.count && a.unreliable_count == b.unreliable_count;
+}
+
+// Every non-empty bucket of the given width overlapping [minTimeMs, maxTimeMs], from the events themselves
+static std::map<double, Prediction::Summary> SummarizeBruteForce(const GameDataTracker& tracker, double minTimeMs, double maxTimeMs, double widthMs) {
+    double startMs = std::floor(minTimeMs / widthMs) * widthMs;
+    double endMs = (std::floor(maxTimeMs / widthMs) + 1) * widthMs;
+    std::map<double, Prediction::Summary> buckets;
+    for (auto const& [timeMs, prediction] : tracker.GetRangeInclusive<Prediction>(startMs, endMs)) {
+        if (timeMs == endMs) {
+            continue;
+        }
+        auto summary = Prediction::Summary::Of(prediction);
+        auto [it, inserted] = buckets.try_emplace(std::floor(timeMs / widthMs) * widthMs, summary);
+        if (!inserted) {
+            it->second.Merge(summary);
+        }
+    }
+    return buckets;
+}
+
+static int CheckPyramid(std::mt19937& rng) {
+    // A replay watched back and forth: mostly moving forward at the prediction rate, sometimes jumping back to rewatch,
+    // with times in 1/8 ms so they land on bucket boundaries too
+    static const OverlapAction ACTIONS[] = { SKIP, REPLACE, REPLACE_IF_EARLIER };
+    static const double RADII_MS[] = { 0, 16.5, 33, 100 };
+    std::uniform_real_distribution<double> unit(0, 1);
+    GameDataTracker tracker;
+    double timeMs = 0;
+    double lastTimeMs = 0;
+    for (int i = 0; i < NUM_PREDICTIONS; i++) {
+        timeMs = unit(rng) < 0.005 ? timeMs * unit(rng) : timeMs + static_cast<double>(rng() % 400) / 8;
+        lastTimeMs = std::max(lastTimeMs, timeMs);
+        OverlapOptions options = { .overlapRadiusMs = RADII_MS[rng() % std::size(RADII_MS)], .overlapAction = ACTIONS[rng() % std::size(ACTIONS)] };
+        tracker.AddEvent(timeMs, MakePrediction(rng), options);
+    }
+
+    std::uniform_real_distribution<double> start(-1'000, lastTimeMs + 1'000);
+    int numFailed = 0;
+    for (int level : { 0, 1, 3, 6, 10, PYRAMID_NUM_LEVELS - 1 }) {
+        double widthMs = PYRAMID_BASE_BUCKET_MS * static_cast<double>(int64_t(1) << level);
+        for (int i = 0; i < 20; i++) {
+            // The first range covers everything, so no bucket is left over once its events are gone
+            double minTimeMs = i == 0 ? -1'000 : start(rng);
+            double maxTimeMs = i == 0 ? lastTimeMs + 1'000 : minTimeMs + unit(rng) * lastTimeMs / 4;
+            std::map<double, Prediction::Summary> summaries;
+            tracker.ForEachSummary<Prediction>(minTimeMs, maxTimeMs, widthMs, [&](double bucketStartMs, double bucketWidthMs, const Prediction::Summary& summary) {
+                if (bucketWidthMs == widthMs) {
+                    summaries.emplace(bucketStartMs, summary);
+                }
+            });
+            auto expected = SummarizeBruteForce(tracker, minTimeMs, maxTimeMs, widthMs);
+            bool same = summaries.size() == expected.size() && std::equal(summaries.begin(), summaries.end(), expected.begin(),
+                [](const auto& a, const auto& b) { return a.first == b.first && SameSummary(a.second, b.second); });
+            if (!same) {
+                std::printf("FAILED: level %d over [%.1f, %.1f], %zu buckets, expected %zu\n", level, minTimeMs, maxTimeMs,
+                    summaries.size(), expected.size());
+                numFailed++;
+            }
+        }
+    }
+    std::printf("pyramid after %d predictions added back and forth: %s\n", NUM_PREDICTIONS, numFailed == 0 ? "ok" : "FAILED");
+    return numFailed;
+}
+
+// An event whose summary counts the work done building it
+static int64_t numSummaryOps = 0;
+
+struct CountedEvent {
+    auto operator<=>(const CountedEvent&) const = default;
+
+    struct Summary {
+        int count;
+
+        static Summary Of(const CountedEvent&) {
+            numSummaryOps++;
+            return { 1 };
+        }
+
+        void Merge(const Summary& other) {
+            numSummaryOps++;
+            count += other.count;
+        }
+    };
+};
+
+static int CheckUpdateCost() {
+    // Events every 16 ms, so each base bucket holds 8, and a radius touching at most 2 base buckets
+    static const double SPACING_MS = 16;
+    static const int EVENTS_PER_BUCKET = static_cast<int>(PYRAMID_BASE_BUCKET_MS / SPACING_MS);
+    // Per base bucket: an Of() and a Merge() per event, then merging two children on each level above
+    static const int64_t MAX_OPS = 2 * (2 * EVENTS_PER_BUCKET + 2 * PYRAMID_NUM_LEVELS);
+
+    GameDataTracker tracker;
+    int64_t maxOps = 0;
+    for (int i = 0; i < NUM_COUNTED_EVENTS; i++) {
+        numSummaryOps = 0;
+        tracker.AddEvent(i * SPACING_MS, CountedEvent{}, { .overlapRadiusMs = SPACING_MS / 2, .overlapAction = REPLACE });
+        maxOps = std::max(maxOps, numSummaryOps);
+    }
+    bool passed = maxOps <= MAX_OPS;
+    std::printf("pyramid update over %d events: at most %lld summary operations per add, limit %lld: %s\n", NUM_COUNTED_EVENTS,
+        static_cast<long long>(maxOps), static_cast<long long>(MAX_OPS), passed ? "ok" : "FAILED");
+    return passed ? 0 : 1;
+}
+
+static int CheckAddEventResult() {
+    // As the big boost pickup hook adds them: duplicates of the same pad within 200 ms are skipped
+    OverlapOptions options = { .overlapRadiusMs = 200, .onlyLookForEqual = true };
+    GameDataTracker tracker;
+    bool passed = tracker.AddEvent(1'000, BigBoostPickupEvent(3), options)
+        && !tracker.AddEvent(1'100, BigBoostPickupEvent(3), options)
+        && tracker.AddEvent(1'100, BigBoostPickupEvent(4), options)
+        && tracker.AddEvent(1'300, BigBoostPickupEvent(3), options);
+
+    // As seconds are added: an earlier time replaces, a later one is skipped
+    OverlapOptions earlierOptions = { .overlapRadiusMs = 1'200, .onlyLookForEqual = true, .overlapAction = REPLACE_IF_EARLIER };
+    passed = passed && tracker.AddEvent(5'000, SecondEvent(120, false), earlierOptions)
+        && !tracker.AddEvent(5'500, SecondEvent(120, false), earlierOptions)
+        && tracker.AddEvent(4'500, SecondEvent(120, false), earlierOptions);
+
+    passed = passed && std::ranges::distance(tracker.GetAll<BigBoostPickupEvent>()) == 3 && tracker.GetMostRecentTimeMs<SecondEvent>(10'000) == 4'500;
+    std::printf("AddEvent() results: %s\n", passed ? "ok" : "FAILED");
+    return passed ? 0 : 1;
+}
+
+int main() {
+    std::mt19937 rng(1);
+    int numFailed = CheckAddEventResult();
+    numFailed += CheckForEachSkipping(rng);
+    numFailed += CheckPyramid(rng);
+    numFailed += CheckUpdateCost();
+    return numFailed == 0 ? 0 : 1;
+}
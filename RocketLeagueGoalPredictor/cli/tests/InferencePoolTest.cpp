@@ -0,0 +1,65 @@
+#include "../../InferencePool.h"
+#include "../../TimedTaskSet.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// Checks that InferencePool::Stop() discards queued jobs rather than running them, and that a TimedTaskSet still
+// counts discarded jobs as finished, so waiting for it doesn't time out.
+
+static const int NUM_QUEUED_JOBS = 10;
+
+int main() {
+    InferencePool pool;
+    pool.Start(1);
+    TimedTaskSet<int> tasks;
+    auto launch = [&](auto job) { pool.Submit(std::move(job)); };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool blockerStarted = false;
+    bool blockerReleased = false;
+    std::atomic<int> numRun = 0;
+
+    // Occupies the only lane until released, so every later job stays queued
+    tasks.Add(0, [&](InferenceLane&) {
+        std::unique_lock lock(mutex);
+        blockerStarted = true;
+        changed.notify_all();
+        changed.wait(lock, [&] { return blockerReleased; });
+        numRun++;
+        return 0;
+    }, launch);
+    for (int i = 1; i <= NUM_QUEUED_JOBS; i++) {
+        tasks.Add(i, [&](InferenceLane&) {
+            numRun++;
+            return 0;
+        }, launch);
+    }
+    {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return blockerStarted; });
+    }
+
+    // Stop() takes the lanes and the queued jobs together, so once the lanes are gone the jobs have been discarded
+    std::thread stopper([&] { pool.Stop(); });
+    while (pool.GetNumLanes() > 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard lock(mutex);
+        blockerReleased = true;
+    }
+    changed.notify_all();
+    stopper.join();
+
+    bool finished = tasks.WaitAll(std::chrono::milliseconds(1000));
+    size_t numCompleted = tasks.GetCompletedTasks().size();
+    bool passed = numRun == 1 && finished && numCompleted == 1;
+    std::printf("%d of %d jobs run, %zu completed, all finished: %s: %s\n", numRun.load(), NUM_QUEUED_JOBS + 1, numCompleted,
+        finished ? "yes" : "no", passed ? "ok" : "FAILED");
+    return passed ? 0 : 1;
+}
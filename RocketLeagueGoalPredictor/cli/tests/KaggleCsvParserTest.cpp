@@ -0,0 +1,149 @@
+#include "../KaggleCsvParser.h"
+#include "../../FeatureBuilder.h"
+#include "../../LogSink.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Differential fuzz test of the CSV parser's number parsing against std::from_chars, which it must match bit for bit,
+// including which fields it rejects: random fields through ParseCsvFloat(), then whole CSVs of them through
+// KaggleCsvParser::Parse(), where fields are followed by the rest of the file and so take the 8-bytes-at-a-time path.
+
+static const int NUM_FIELDS = 1'000'000;
+static const int NUM_ROWS = 2'000;
+
+// What a field should parse as: missing values as NaN, and anything else exactly as std::from_chars would
+static bool ParseReference(std::string_view field, float& value) {
+    if (field.empty() || field == "null" || field == "nan" || field == "NaN") {
+        value = std::numeric_limits<float>::quiet_NaN();
+        return true;
+    }
+    auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+static bool SameFloat(float a, float b) {
+    return (std::isnan(a) && std::isnan(b)) || std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// Mostly numbers in the shapes the Kaggle data and other writers produce, plus digit strings of any length and a few
+// that aren't numbers at all
+static std::string MakeRandomField(std::mt19937_64& rng) {
+    char text[64];
+    switch (rng() % 6) {
+    case 0: {
+        double value = static_cast<double>(static_cast<int64_t>(rng() % 2'000'000'000) - 1'000'000'000) / std::pow(10, rng() % 12);
+        std::snprintf(text, sizeof(text), "%.*f", static_cast<int>(rng() % 11), value);
+        return text;
+    }
+    case 1:
+        std::snprintf(text, sizeof(text), "%.4f", static_cast<double>(static_cast<int64_t>(rng() % 100'000'000) - 50'000'000) / 1e4);
+        return text;
+    case 2:
+        std::snprintf(text, sizeof(text), "%lld", static_cast<long long>(rng() % 100'000'000'000ull));
+        return text;
+    case 3:
+        std::snprintf(text, sizeof(text), "%.9g", std::ldexp(static_cast<double>(rng() % 100'000), static_cast<int>(rng() % 60) - 30));
+        return text;
+    case 4: {
+        std::string digits = rng() % 2 ? "-" : "";
+        int length = 1 + static_cast<int>(rng() % 25);
+        int dotIndex = rng() % 2 ? static_cast<int>(rng() % length) : -1;
+        for (int i = 0; i < length; i++) {
+            if (i == dotIndex) {
+                digits += '.';
+            }
+            digits += static_cast<char>('0' + rng() % 10);
+        }
+        return digits;
+    }
+    default: {
+        static const char* const ODD_FIELDS[] = { "", "null", "nan", "NaN", "-", ".", "1.2.3", "abc", "1e", "-.5", "5.",
+            "+1", "0x10", "inf", "1e-50", "3.4e39", "00000000000000000000001.5", "0.99999999999999999999" };
+        return ODD_FIELDS[rng() % std::size(ODD_FIELDS)];
+    }
+    }
+}
+
+static int CheckFields(std::mt19937_64& rng) {
+    int numMismatches = 0;
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        std::string field = MakeRandomField(rng);
+        float value = 0;
+        float expected = 0;
+        bool parsed = ParseCsvFloat(field.data(), field.data() + field.size(), value);
+        bool expectedParsed = ParseReference(field, expected);
+        if (parsed != expectedParsed || (parsed && !SameFloat(value, expected))) {
+            if (numMismatches++ < 10) {
+                std::printf("  '%s': parsed %d %.9g, expected %d %.9g\n", field.c_str(), parsed, value, expectedParsed, expected);
+            }
+        }
+    }
+    std::printf("%d fields through ParseCsvFloat(): %d mismatches\n", NUM_FIELDS, numMismatches);
+    return numMismatches;
+}
+
+static int CheckCsv(std::mt19937_64& rng) {
+    std::string csv = "id";
+    for (int column = 0; column < INPUT_DIM; column++) {
+        csv += ",c" + std::to_string(column);
+    }
+    csv += '\n';
+
+    std::vector<float> expected;
+    for (int row = 0; row < NUM_ROWS; row++) {
+        csv += std::to_string(row);
+        for (int column = 0; column < INPUT_DIM; column++) {
+            // Only fields which parse, since anything else ends the input
+            std::string field;
+            float value;
+            do {
+                field = MakeRandomField(rng);
+            } while (!ParseReference(field, value));
+            csv += ',' + field;
+            expected.push_back(value);
+        }
+        csv += rng() % 4 == 0 ? "\r\n" : "\n";
+    }
+    // A malformed last row, which should end parsing with everything before it intact
+    csv += "bad\n";
+
+    KaggleCsvParser parser;
+    std::vector<float> rows(static_cast<size_t>(NUM_ROWS + 1) * INPUT_DIM);
+    std::vector<int64_t> ids(NUM_ROWS + 1);
+    size_t numRows = 0;
+    if (parser.Begin(csv.data(), csv.size())) {
+        // Odd sized batches, so batches end at different points in the file
+        while (size_t numParsed = parser.Parse(rows.data() + numRows * INPUT_DIM, ids.data() + numRows, std::min<size_t>(37, ids.size() - numRows))) {
+            numRows += numParsed;
+        }
+    }
+
+    int numMismatches = 0;
+    for (size_t row = 0; row < std::min<size_t>(numRows, NUM_ROWS); row++) {
+        numMismatches += ids[row] != static_cast<int64_t>(row);
+        for (int column = 0; column < INPUT_DIM; column++) {
+            numMismatches += !SameFloat(rows[row * INPUT_DIM + column], expected[row * INPUT_DIM + column]);
+        }
+    }
+    bool passed = numRows == NUM_ROWS && parser.HasFailed() && numMismatches == 0;
+    std::printf("%d rows through KaggleCsvParser::Parse(): %zu parsed, %d mismatches, %s at the malformed row\n", NUM_ROWS,
+        numRows, numMismatches, parser.HasFailed() ? "stopped" : "didn't stop");
+    FlushLogRecords(SIZE_MAX, [](std::string_view) {});
+    return passed ? 0 : 1;
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    int numFailures = CheckFields(rng);
+    numFailures += CheckCsv(rng);
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include "../../LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks LatencyHistogram's log-linear buckets through what it reports: every value below 64us must come back exactly,
+// anything up to the ~19 hour clamp within 3%, and percentiles of random samples within 3% of the same percentiles
+// taken from the sorted samples.
+
+static const uint64_t MAX_EXACT_US = 64;
+static const int MAX_VALUE_BITS = 36;
+static const double MAX_RELATIVE_ERROR = 0.03;
+static const int NUM_SAMPLES = 100'000;
+
+// What the histogram reports for a single value. Percentiles are clamped to the recorded min and max, so the value is
+// recorded between a smaller and a larger one to get its bucket's own value back.
+static double ReportedUs(uint64_t valueUs) {
+    LatencyHistogram histogram;
+    histogram.Record(uint64_t(0));
+    histogram.Record(valueUs);
+    histogram.Record(uint64_t(1) << MAX_VALUE_BITS);
+    return histogram.GetPercentileMs(0.5) * 1000;
+}
+
+static int CheckExactValues() {
+    int numFailed = 0;
+    for (uint64_t valueUs = 1; valueUs < MAX_EXACT_US; valueUs++) {
+        double reportedUs = ReportedUs(valueUs);
+        if (reportedUs != static_cast<double>(valueUs)) {
+            std::printf("FAILED: %lluus reported as %.3fus\n", static_cast<unsigned long long>(valueUs), reportedUs);
+            numFailed++;
+        }
+    }
+    std::printf("values below %lluus: %s\n", static_cast<unsigned long long>(MAX_EXACT_US), numFailed == 0 ? "exact" : "FAILED");
+    return numFailed;
+}
+
+static int CheckRelativeError(std::mt19937_64& rng) {
+    // Both ends of every power of two up to the clamp, and random values in between
+    std::vector<uint64_t> values;
+    for (int bits = 7; bits <= MAX_VALUE_BITS; bits++) {
+        uint64_t low = uint64_t(1) << (bits - 1);
+        uint64_t high = (uint64_t(1) << bits) - 1;
+        values.push_back(low);
+        values.push_back(low + 1);
+        values.push_back(high);
+        for (int i = 0; i < 1'000; i++) {
+            values.push_back(low + rng() % (high - low + 1));
+        }
+    }
+
+    int numFailed = 0;
+    double maxError = 0;
+    for (uint64_t valueUs : values) {
+        double error = std::abs(ReportedUs(valueUs) - static_cast<double>(valueUs)) / static_cast<double>(valueUs);
+        maxError = std::max(maxError, error);
+        if (error > MAX_RELATIVE_ERROR) {
+            if (numFailed++ < 10) {
+                std::printf("FAILED: %lluus reported %.2f%% off\n", static_cast<unsigned long long>(valueUs), error * 100);
+            }
+        }
+    }
+    std::printf("%zu values from %lluus to 2^%d us: worst error %.2f%%, %s\n", values.size(),
+        static_cast<unsigned long long>(MAX_EXACT_US), MAX_VALUE_BITS, maxError * 100, numFailed == 0 ? "ok" : "FAILED");
+    return numFailed;
+}
+
+static int CheckPercentiles(std::mt19937_64& rng) {
+    // Long tailed, like the pipeline stages: mostly around a millisecond, with the odd stall
+    std::lognormal_distribution<double> latencyUs(std::log(1'000.0), 1.5);
+    LatencyHistogram histogram;
+    std::vector<uint64_t> samples;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        uint64_t valueUs = static_cast<uint64_t>(latencyUs(rng));
+        histogram.Record(valueUs);
+        samples.push_back(valueUs);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    int numFailed = 0;
+    for (double fraction : { 0.0, 0.001, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0 }) {
+        // The same rank GetPercentileMs() looks for
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * samples.size() + 0.5));
+        double expectedMs = samples[rank - 1] / 1000.0;
+        double reportedMs = histogram.GetPercentileMs(fraction);
+        bool passed = std::abs(reportedMs - expectedMs) <= std::max(expectedMs * MAX_RELATIVE_ERROR, 0.0005);
+        std::printf("  p%-6g %10.3fms, sorted %10.3fms%s\n", fraction * 100, reportedMs, expectedMs, passed ? "" : " FAILED");
+        numFailed += !passed;
+    }
+    bool extremesPassed = histogram.GetCount() == NUM_SAMPLES && histogram.GetMinMs() == samples.front() / 1000.0
+        && histogram.GetMaxMs() == samples.back() / 1000.0;
+    std::printf("percentiles of %d samples: %s\n", NUM_SAMPLES, numFailed == 0 && extremesPassed ? "ok" : "FAILED");
+    return numFailed + !extremesPassed;
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+    int numFailed = CheckExactValues();
+    numFailed += CheckRelativeError(rng);
+    numFailed += CheckPercentiles(rng);
+    return numFailed == 0 ? 0 : 1;
+}
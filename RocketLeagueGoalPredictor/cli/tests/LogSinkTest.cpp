@@ -0,0 +1,43 @@
+#include "../../LogSink.h"
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Checks that a record whose formatting throws still gets published, rather than leaving its claimed slot blocking
+// every record after it: pushes records around ones whose argument formatters throw, narrow and wide, and expects all
+// of them back in order.
+
+struct ThrowingArg {};
+
+template <typename CharT>
+struct std::formatter<ThrowingArg, CharT> {
+    constexpr auto parse(std::basic_format_parse_context<CharT>& ctx) { return ctx.begin(); }
+    template <typename Context>
+    auto format(const ThrowingArg&, Context&) const -> typename Context::iterator {
+        throw std::runtime_error("formatter failed");
+    }
+};
+
+int main() {
+    LOG("before {}", 1);
+    LOG("throwing {}", ThrowingArg{});
+    LOG(L"wide throwing {}", ThrowingArg{});
+    LOG("after {}", 2);
+
+    std::vector<std::string> flushed;
+    FlushLogRecords(100, [&](std::string_view text) { flushed.emplace_back(text); });
+
+    std::vector<std::string> expected = {
+        "before 1",
+        "Log formatting failed: throwing {}",
+        "wide throwing {}",
+        "after 2",
+    };
+    bool passed = flushed == expected;
+    for (const auto& text : flushed) {
+        std::printf("  %s\n", text.c_str());
+    }
+    std::printf("%zu of %zu records flushed as expected: %s\n", flushed.size(), expected.size(), passed ? "ok" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+#include "../ConsoleLog.h"
+#include "../OfflinePipeline.h"
+#include "../PredictionWriter.h"
+#include "../RowSource.h"
+#include "../../InferenceEngine.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Checks that RunOfflinePipeline() writes exactly what the lane runner in main.cpp does, reading a RowSource in order
+// and scoring each batch with PredictBatch(): CSVs with and without an id column, so ids of chunks parsed out of order
+// have to be offset by the rows before them, and with a malformed row, where both must stop at the same row and report
+// failure. Many small chunks over several workers make batches finish out of order for the writer to put back.
+//
+// The model is written by the test: a sigmoid of the first OUTPUT_DIM inputs, so each prediction only depends on its own
+// row and the two runners' different batch sizes can't change any result.
+
+static const int NUM_ROWS = 1'000;
+static const int MALFORMED_ROW = 537;
+static const size_t LANE_BATCH_SIZE = 7;
+static const size_t PIPELINE_BATCH_SIZE = 16;
+static const int NUM_WORKERS = 3;
+
+// Just enough protobuf to write an ONNX model without the onnx package
+static void AppendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static void AppendVarintField(std::string& out, int field, uint64_t value) {
+    AppendVarint(out, static_cast<uint64_t>(field) << 3);
+    AppendVarint(out, value);
+}
+
+static void AppendBytesField(std::string& out, int field, std::string_view bytes) {
+    AppendVarint(out, static_cast<uint64_t>(field) << 3 | 2);
+    AppendVarint(out, bytes.size());
+    out += bytes;
+}
+
+// TensorProto of a single int64
+static std::string MakeInt64Initializer(const char* name, int64_t value) {
+    std::string tensor;
+    AppendVarintField(tensor, 1, 1); // dims
+    AppendVarintField(tensor, 2, 7); // data_type INT64
+    AppendBytesField(tensor, 8, name);
+    AppendBytesField(tensor, 9, std::string_view(reinterpret_cast<const char*>(&value), sizeof(value))); // raw_data, little endian
+    return tensor;
+}
+
+// ValueInfoProto of a float tensor shaped [batch, numColumns]
+static std::string MakeMatrixInfo(const char* name, int64_t numColumns) {
+    std::string batchDim;
+    AppendBytesField(batchDim, 2, "batch"); // dim_param
+    std::string columnDim;
+    AppendVarintField(columnDim, 1, numColumns); // dim_value
+    std::string shape;
+    AppendBytesField(shape, 1, batchDim);
+    AppendBytesField(shape, 1, columnDim);
+    std::string tensorType;
+    AppendVarintField(tensorType, 1, 1); // elem_type FLOAT
+    AppendBytesField(tensorType, 2, shape);
+    std::string type;
+    AppendBytesField(type, 1, tensorType);
+    std::string info;
+    AppendBytesField(info, 1, name);
+    AppendBytesField(info, 2, type);
+    return info;
+}
+
+static std::string MakeNode(std::initializer_list<const char*> inputs, const char* output, const char* opType) {
+    std::string node;
+    for (const char* input : inputs) {
+        AppendBytesField(node, 1, input);
+    }
+    AppendBytesField(node, 2, output);
+    AppendBytesField(node, 4, opType);
+    return node;
+}
+
+// output = Sigmoid(input[:, 0:OUTPUT_DIM])
+static std::string MakeModel() {
+    std::string graph;
+    AppendBytesField(graph, 1, MakeNode({ "input", "starts", "ends", "axes" }, "sliced", "Slice"));
+    AppendBytesField(graph, 1, MakeNode({ "sliced" }, "output", "Sigmoid"));
+    AppendBytesField(graph, 2, "offline_pipeline_test");
+    AppendBytesField(graph, 5, MakeInt64Initializer("starts", 0));
+    AppendBytesField(graph, 5, MakeInt64Initializer("ends", OUTPUT_DIM));
+    AppendBytesField(graph, 5, MakeInt64Initializer("axes", 1));
+    AppendBytesField(graph, 11, MakeMatrixInfo("input", INPUT_DIM));
+    AppendBytesField(graph, 12, MakeMatrixInfo("output", OUTPUT_DIM));
+
+    std::string opset;
+    AppendVarintField(opset, 2, 13); // version
+    std::string model;
+    AppendVarintField(model, 1, 8); // ir_version
+    AppendBytesField(model, 7, graph);
+    AppendBytesField(model, 8, opset);
+    return model;
+}
+
+static void WriteFile(const std::filesystem::path& path, const std::string& contents) {
+    std::ofstream(path, std::ios::binary).write(contents.data(), contents.size());
+}
+
+static std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::string MakeCsv(bool withIds, bool malformed, std::mt19937& rng) {
+    std::uniform_real_distribution<double> value(-3, 3);
+    std::string csv = withIds ? "id," : "";
+    for (int column = 0; column < INPUT_DIM; column++) {
+        csv += column > 0 ? ",c" : "c";
+        csv += std::to_string(column);
+    }
+    csv += '\n';
+
+    char text[32];
+    for (int row = 0; row < NUM_ROWS; row++) {
+        if (withIds) {
+            csv += std::to_string(1'000 + row * 3);
+            csv += ',';
+        }
+        for (int column = 0; column < INPUT_DIM; column++) {
+            bool bad = malformed && row == MALFORMED_ROW && column == INPUT_DIM / 2;
+            std::snprintf(text, sizeof(text), "%.4f", value(rng));
+            csv += column > 0 ? "," : "";
+            csv += bad ? "x" : text;
+        }
+        csv += '\n';
+    }
+    return csv;
+}
+
+// The lane runner's path through the input, in order on this thread
+static bool RunInOrder(InferenceEngine& engine, const std::filesystem::path& inputPath, const std::filesystem::path& outputPath) {
+    auto source = OpenRowSource(inputPath);
+    PredictionWriter writer;
+    if (!source || !writer.Open(outputPath, source->HasTimestamps())) {
+        return false;
+    }
+
+    std::vector<float> rows(LANE_BATCH_SIZE * INPUT_DIM);
+    std::vector<int64_t> ids(LANE_BATCH_SIZE);
+    std::vector<double> timesMs(LANE_BATCH_SIZE);
+    std::vector<PredictionReliability> reliabilities(LANE_BATCH_SIZE);
+    std::vector<Prediction> predictions;
+    PredictBuffers buffers;
+    bool succeeded = true;
+    while (size_t numRows = source->Read(rows.data(), ids.data(), timesMs.data(), reliabilities.data(), LANE_BATCH_SIZE)) {
+        succeeded &= engine.PredictBatch(rows.data(), reliabilities.data(), numRows, NO_AUGMENT, buffers, predictions);
+        writer.Write(ids.data(), timesMs.data(), predictions);
+    }
+    return succeeded && !source->HasFailed();
+}
+
+int main() {
+    auto directory = std::filesystem::temp_directory_path();
+    auto modelPath = directory / "goal_predictor_offline_pipeline_test.onnx";
+    auto inputPath = directory / "goal_predictor_offline_pipeline_test.csv";
+    auto expectedPath = directory / "goal_predictor_offline_pipeline_test_expected.out";
+    auto outputPath = directory / "goal_predictor_offline_pipeline_test.out";
+    WriteFile(modelPath, MakeModel());
+
+    InferenceEngine engine;
+    bool loaded = engine.Initialize(modelPath.string());
+    FlushLogToStderr();
+    if (!loaded) {
+        std::printf("FAILED: couldn't load the test model\n");
+        return 1;
+    }
+
+    std::mt19937 rng(1);
+    int numFailed = 0;
+    for (bool withIds : { true, false }) {
+        for (bool malformed : { false, true }) {
+            WriteFile(inputPath, MakeCsv(withIds, malformed, rng));
+            bool inOrderSucceeded = RunInOrder(engine, inputPath, expectedPath);
+            bool pipelineSucceeded = RunOfflinePipeline(inputPath, outputPath, engine,
+                { .augmentation = NO_AUGMENT, .batchSize = PIPELINE_BATCH_SIZE, .numWorkers = NUM_WORKERS });
+            // Malformed inputs log why, which isn't a failure here
+            FlushLogToStderr();
+
+            std::string expected = ReadFile(expectedPath);
+            std::string output = ReadFile(outputPath);
+            auto numLines = std::count(expected.begin(), expected.end(), '\n');
+            bool passed = output == expected && numLines == 1 + (malformed ? MALFORMED_ROW : NUM_ROWS)
+                && inOrderSucceeded == !malformed && pipelineSucceeded == !malformed;
+            std::printf("%s ids%s: %lld lines, %s\n", withIds ? "with" : "without", malformed ? ", malformed" : "",
+                static_cast<long long>(numLines), passed ? "ok" : output == expected ? "FAILED" : "FAILED, outputs differ");
+            numFailed += !passed;
+        }
+    }
+
+    for (const auto& path : { modelPath, inputPath, expectedPath, outputPath }) {
+        std::filesystem::remove(path);
+    }
+    return numFailed == 0 ? 0 : 1;
+}
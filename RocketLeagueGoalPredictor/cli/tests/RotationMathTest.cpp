@@ -0,0 +1,94 @@
+#include "../../RotationMath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <random>
+#include <vector>
+
+// Checks the batched RotatorsToRotAndUpVectors() against a double precision evaluation of the same formulas, and
+// against the scalar RotatorToRotAndUpVectors() it replaces: every value of each angle on its own, then random
+// rotators both in the game's range and unwrapped far outside it.
+
+// Largest error allowed against the double precision result, for any rotator
+static const double MAX_EXACT_ERROR = 5e-7;
+// Largest difference allowed from the scalar version for rotators in the game's +/- half turn range. Outside it the
+// scalar version loses precision itself, as sinf() and cosf() get larger arguments.
+static const double MAX_SCALAR_DIFFERENCE = 1e-6;
+static const size_t NUM_RANDOM_ROTATORS = 500'000;
+
+struct ErrorStats {
+    double maxExactError = 0;
+    double maxScalarDifference = 0;
+};
+
+static void RotatorToRotAndUpVectorsExact(const Rotator3i& R, double* out) {
+    const double unitsToRad = std::numbers::pi / 32768;
+    double sinPitch = std::sin(R.pitch * unitsToRad), cosPitch = std::cos(R.pitch * unitsToRad);
+    double sinYaw = std::sin(R.yaw * unitsToRad), cosYaw = std::cos(R.yaw * unitsToRad);
+    double sinRoll = std::sin(R.roll * unitsToRad), cosRoll = std::cos(R.roll * unitsToRad);
+    out[0] = cosPitch * cosYaw;
+    out[1] = cosPitch * sinYaw;
+    out[2] = sinPitch;
+    out[3] = -cosYaw * sinPitch * cosRoll - sinYaw * sinRoll;
+    out[4] = -sinYaw * sinPitch * cosRoll + cosYaw * sinRoll;
+    out[5] = cosPitch * cosRoll;
+}
+
+static ErrorStats Measure(const std::vector<Rotator3i>& rotators) {
+    std::vector<Vec3f> rots(rotators.size());
+    std::vector<Vec3f> ups(rotators.size());
+    RotatorsToRotAndUpVectors(rotators.data(), rotators.size(), rots.data(), ups.data());
+
+    ErrorStats stats;
+    for (size_t i = 0; i < rotators.size(); i++) {
+        double exact[6];
+        RotatorToRotAndUpVectorsExact(rotators[i], exact);
+        auto [scalarRot, scalarUp] = RotatorToRotAndUpVectors(rotators[i]);
+        float batched[6] = { rots[i].x, rots[i].y, rots[i].z, ups[i].x, ups[i].y, ups[i].z };
+        float scalar[6] = { scalarRot.x, scalarRot.y, scalarRot.z, scalarUp.x, scalarUp.y, scalarUp.z };
+        for (int j = 0; j < 6; j++) {
+            stats.maxExactError = std::max(stats.maxExactError, std::abs(batched[j] - exact[j]));
+            stats.maxScalarDifference = std::max(stats.maxScalarDifference, static_cast<double>(std::abs(batched[j] - scalar[j])));
+        }
+    }
+    return stats;
+}
+
+static bool Check(const char* name, const std::vector<Rotator3i>& rotators, bool inGameRange) {
+    ErrorStats stats = Measure(rotators);
+    bool passed = stats.maxExactError <= MAX_EXACT_ERROR && (!inGameRange || stats.maxScalarDifference <= MAX_SCALAR_DIFFERENCE);
+    std::printf("%-28s max error %.3g, max difference from scalar %.3g: %s\n", name, stats.maxExactError,
+        stats.maxScalarDifference, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+int main() {
+    bool passed = true;
+
+    for (int axis = 0; axis < 3; axis++) {
+        std::vector<Rotator3i> rotators;
+        for (int32_t units = -32768; units < 32768; units++) {
+            Rotator3i rotator = { 0, 0, 0 };
+            (axis == 0 ? rotator.pitch : axis == 1 ? rotator.yaw : rotator.roll) = units;
+            rotators.push_back(rotator);
+        }
+        const char* names[] = { "every pitch", "every yaw", "every roll" };
+        passed &= Check(names[axis], rotators, true);
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int32_t> inRange(-32768, 32767);
+    std::uniform_int_distribution<int32_t> unwrapped(-4'000'000, 4'000'000);
+    std::vector<Rotator3i> rotators(NUM_RANDOM_ROTATORS);
+    for (auto& rotator : rotators) {
+        rotator = { inRange(rng), inRange(rng), inRange(rng) };
+    }
+    passed &= Check("random in game range", rotators, true);
+    for (auto& rotator : rotators) {
+        rotator = { unwrapped(rng), unwrapped(rng), unwrapped(rng) };
+    }
+    passed &= Check("random unwrapped", rotators, false);
+
+    return passed ? 0 : 1;
+}
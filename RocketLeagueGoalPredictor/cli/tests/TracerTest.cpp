@@ -0,0 +1,43 @@
+#include "../../Tracer.h"
+#include <cstdio>
+#include <filesystem>
+#include <latch>
+#include <thread>
+#include <vector>
+
+// Checks that trace rings are reused once their threads exit, as when the inference pool restarts: after many
+// generations of short-lived threads, the dump only holds the rings of one generation, with each thread's own events.
+
+static const int NUM_GENERATIONS = 20;
+static const int NUM_THREADS = 4;
+static const int NUM_EVENTS_PER_THREAD = 100;
+
+int main() {
+    SetTracingEnabled(true);
+    for (int generation = 0; generation < NUM_GENERATIONS; generation++) {
+        // All of a generation's threads are alive at once, so each needs a ring of its own
+        std::latch allTraced(NUM_THREADS);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < NUM_THREADS; i++) {
+            threads.emplace_back([&] {
+                SetTraceThreadName("Worker");
+                for (int event = 0; event < NUM_EVENTS_PER_THREAD; event++) {
+                    ScopedTrace trace("Event");
+                }
+                allTraced.arrive_and_wait();
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    auto path = std::filesystem::temp_directory_path() / "goal_predictor_tracer_test.json";
+    int numEvents = WriteTraceJson(path);
+    std::filesystem::remove(path);
+
+    bool passed = numEvents == NUM_THREADS * NUM_EVENTS_PER_THREAD;
+    std::printf("%d events dumped after %d generations of %d threads, expected %d: %s\n", numEvents, NUM_GENERATIONS,
+        NUM_THREADS, NUM_THREADS * NUM_EVENTS_PER_THREAD, passed ? "ok" : "FAILED");
+    return passed ? 0 : 1;
+}
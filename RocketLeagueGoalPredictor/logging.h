@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "bakkesmod/wrappers/cvarmanagerwrapper.h"
+#include "LogSink.h"
 
 extern std::shared_ptr<CVarManagerWrapper> _globalCvarManager;
 constexpr bool DEBUG_LOG = false;
@@ -51,19 +52,6 @@ struct FormatWstring
 };
 
 
-template <typename... Args>
-void LOG(std::string_view format_str, Args&&... args)
-{
-	_globalCvarManager->log(std::vformat(format_str, std::make_format_args(args...)));
-}
-
-template <typename... Args>
-void LOG(std::wstring_view format_str, Args&&... args)
-{
-	_globalCvarManager->log(std::vformat(format_str, std::make_wformat_args(args...)));
-}
-
-
 template <typename... Args>
 void DEBUGLOG(const FormatString& format_str, Args&&... args)
 {
@@ -71,7 +59,7 @@ void DEBUGLOG(const FormatString& format_str, Args&&... args)
 	{
 		auto text = std::vformat(format_str.str, std::make_format_args(args...));
 		auto location = format_str.GetLocation();
-		_globalCvarManager->log(std::format("{} {}", text, location));
+		LOG("{} {}", text, location);
 	}
 }
 
@@ -82,6 +70,6 @@ void DEBUGLOG(const FormatWstring& format_str, Args&&... args)
 	{
 		auto text = std::vformat(format_str.str, std::make_wformat_args(args...));
 		auto location = format_str.GetLocation();
-		_globalCvarManager->log(std::format(L"{} {}", text, location));
+		LOG(L"{} {}", text, location);
 	}
 }
@@ -37,32 +37,6 @@ inline static std::string GetId(PriWrapper pri) {
     return pri.GetUniqueIdWrapper().GetIdString();
 }
 
-inline static std::pair<Vector, Vector> RotatorToRotAndUpVectors(const Rotator R) {
-    Vector rot;
-    Vector up;
-
-    float fPitch = R.Pitch * static_cast<float>(CONST_UnrRotToRad);
-    float fYaw = R.Yaw * static_cast<float>(CONST_UnrRotToRad);
-    float fRoll = R.Roll * static_cast<float>(CONST_UnrRotToRad);
-
-    float SinPitch = sinf(fPitch);
-    float CosPitch = cosf(fPitch);
-    float SinYaw = sinf(fYaw);
-    float CosYaw = cosf(fYaw);
-    float SinRoll = sinf(fRoll);
-    float CosRoll = cosf(fRoll);
-
-    rot.X = CosPitch * CosYaw;
-    rot.Y = CosPitch * SinYaw;
-    rot.Z = SinPitch;
-
-    up.X = -CosYaw * SinPitch * CosRoll - SinYaw * SinRoll;
-    up.Y = -SinYaw * SinPitch * CosRoll + CosYaw * SinRoll;
-    up.Z = CosPitch * CosRoll;
-
-    return { rot, up };
-}
-
 inline static bool IsSpectatingOnline(std::shared_ptr<GameWrapper> gameWrapper) {
     if (!gameWrapper->IsInOnlineGame()) {
         return false;